@@ -10,7 +10,13 @@
 //#define __DEBUG_LINE(...)
 //#endif
 
-#define __DEBUG__              
+#define __LAZY_FLAGS__      //  defers computing F until a flag is read.
+
+//  FAST runs without any debugger bookkeeping, INSTRUMENTED feeds breakpoints and the debug window.
+enum class debug_policy{
+    FAST,
+    INSTRUMENTED
+};
 
 constexpr double operator"" _n(long double seconds){
     return 1000000000*seconds;
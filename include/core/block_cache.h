@@ -0,0 +1,63 @@
+/*
+    caches straight-line runs of predecoded instructions, keyed by rom bank and address.
+*/
+#pragma once
+#include<common_defs.h>
+#include<core/instructions.h>
+#include<unordered_map>
+#include<vector>
+#include<array>
+
+struct predecoded_instr_t{
+    _cpu_function_prototype function;
+    _instr_ticks_entry cycles;  //  resolved (no branch, branch) ticks.
+    uint16_t operand;           //  immediate bytes, or the opcode following a 0xCB prefix.
+    uint8_t opcode;
+    uint8_t length;             //  byte length including the 0xCB prefix.
+};
+
+struct basic_block_t{
+    std::vector<predecoded_instr_t> instrs;
+    uint16_t start_adr;
+    uint16_t end_adr;           //  one past the last byte of the block.
+    size_t cycles;              //  total ticks when no branch is taken.
+    size_t executions{0};
+    //  side-effect free polling loop branching back to its own start, see block_cache_t::detect_idle.
+    bool idle{false};
+    bool idle_reads_hl{false};  //  polls (hl), whose address is only known once the loop runs.
+    _cpu_function_prototype native{nullptr};   //  translated code, see core/jit.h.
+};
+
+struct block_cache_t{
+    static constexpr size_t MAX_BLOCK_LENGTH = 32;
+    basic_block_t* find(uint16_t adr, size_t bank);
+    //  returns nullptr when the instruction at adr can't be cached.
+    basic_block_t* build(memory_t& mem, uint16_t adr, size_t bank);
+    //  blocks outside of rom are tracked per 16 byte line, a write only drops the blocks spanning its line.
+    bool is_code(uint16_t adr) const { return code_lines[adr>>8]>>((adr>>4)&0x0F)&1; }
+    //  pages holding any cached code stay off the write fast path.
+    bool is_code_page(uint16_t adr) const { return code_lines[adr>>8]; }
+    //  drops the blocks overlapping [first, last] and hands pages left without code back to the fast path.
+    void invalidate(memory_t& mem, uint16_t first, uint16_t last);
+    void clear();
+    void drop_native();
+    //  merges runs of instr_table::fused_range into single entries, changing it clears the cache.
+    void set_fusion(bool enable){ if(enable != fuse){ fuse = enable; clear(); } }
+    //  bumped on every invalidation so an executing block can tell it has been freed.
+    size_t get_generation() const { return generation; }
+protected:
+    static uint32_t key(uint16_t adr, size_t bank){ return (bank<<16)|adr; }
+    void mark_code_lines(memory_t& mem, const basic_block_t& block, uint32_t key);
+    void erase(memory_t& mem, uint32_t key);
+    //  calls f with every line the block spans, then with their work ram echo.
+    template<typename F> static void for_each_line(const basic_block_t& block, F f);
+    static void detect_idle(basic_block_t& block);
+    static void fuse_instrs(basic_block_t& block);
+    static int region(uint16_t adr);
+    static bool ends_block(uint8_t opc, size_t length);
+    std::unordered_map<uint32_t, basic_block_t> blocks;
+    std::array<uint16_t,256> code_lines{};  //  one bit per 16 byte line of every page.
+    std::unordered_map<uint16_t, std::vector<uint32_t>> line_blocks;    //  keys of the blocks spanning a line.
+    size_t generation{0};
+    bool fuse{true};
+};
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include<core/instructions.h>
+#include<gameboy.h>
 #include<stdexcept>
 
 enum class BIT:uint8_t{ B0=0x1,B1=0x2,B2=0x4,B3=0x8,B4=0x10,B5=0x20,B6=0x40,B7=0x80 };
@@ -12,10 +13,17 @@ namespace instr_defs{
     enum BIT_VAL { SET=true,UNSET=false };
     template<RI8 reg>__always_inline auto& get_reg(cfa arg){ return arg.gb.regs.get<reg>(); }
     template<RI16 reg>__always_inline auto& get_reg(cfa arg){ return arg.gb.regs.get<reg>(); }
+    //  immediates were fetched when the instruction was decoded.
+    __always_inline uint8_t immediate8(cfa arg){ return arg.operand; }
+    __always_inline uint16_t immediate16(cfa arg){ return arg.operand; }
     template<FI flag>
     __always_inline bool get_flag(cfa arg){ return arg.gb.regs.get_flag<flag>(); }
     template<FI flag>
     __always_inline void set_flag(cfa arg, bool v) { arg.gb.regs.set_flag<flag>(v); }
+    template<FLAG_OP op>
+    __always_inline void set_flags(cfa arg, uint8_t lhs, uint8_t rhs, bool carry, uint8_t result){
+        arg.gb.regs.set_flags<op>(lhs, rhs, carry, result);
+    }
     //  invalid instruction function
     inline void invalid_instr(cfa arg){
         throw std::runtime_error("tried to execute an invalid instruction.");
@@ -27,12 +35,7 @@ namespace instr_defs{
     __always_inline void __adc(cfa arg, uint8_t reg, bool carry){
         auto tmp = get_reg<RI::A>(arg); //  caches the value of the A register for later comparison.
         get_reg<RI::A>(arg)+=reg+carry;
-        set_flag<FI::Z>(arg,!get_reg<RI::A>(arg));
-        set_flag<FI::N>(arg,UNSET);
-        set_flag<FI::H>(arg,
-            (tmp&0x0F)+(reg&0x0F)+carry>0x0F);
-        set_flag<FI::C>(arg,
-            tmp+reg+carry>0xFF);
+        set_flags<FLAG_OP::ADD>(arg,tmp,reg,carry,get_reg<RI::A>(arg));
     }
     template<RI8 src> void adc_a_r8(cfa arg){
         __adc(arg, get_reg<src>(arg), get_flag<FI::C>(arg));
@@ -42,7 +45,7 @@ namespace instr_defs{
         __adc(arg, val, get_flag<FI::C>(arg));
     }
     inline void adc_a_n8(cfa arg){
-        __adc(arg, arg.gb.immediate8(), get_flag<FI::C>(arg));
+        __adc(arg, immediate8(arg), get_flag<FI::C>(arg));
     }
     //  ADD
     __always_inline void __add(cfa arg, uint8_t reg){
@@ -56,7 +59,7 @@ namespace instr_defs{
         __add(arg, val);
     }
     inline void add_a_n8(cfa arg){
-        __add(arg, arg.gb.immediate8());
+        __add(arg, immediate8(arg));
     }
     //  ADD 16
     template<RI16 src> void add_hl_r16(cfa arg){
@@ -74,21 +77,19 @@ namespace instr_defs{
     }
     inline void add_sp_e8(cfa arg){
         uint16_t tmp = get_reg<RI::SP>(arg);
-        get_reg<RI::SP>(arg)+=(int8_t)arg.gb.immediate8();
+        uint8_t imm = immediate8(arg);
+        get_reg<RI::SP>(arg)+=(int8_t)imm;
         set_flag<FI::Z>(arg,UNSET);
         set_flag<FI::N>(arg,UNSET);
         set_flag<FI::H>(arg,
-            (tmp&0x0F)+((uint8_t)arg.gb.immediate8()&0x0F)>0x0F);
+            (tmp&0x0F)+(imm&0x0F)>0x0F);
         set_flag<FI::C>(arg,
-            (tmp&0xFF)+(uint8_t)arg.gb.immediate8()>0xFF);
+            (tmp&0xFF)+imm>0xFF);
     }
     //  AND
     __always_inline void __and(cfa arg, uint8_t val){
         auto& tmp = (get_reg<RI::A>(arg)&=val);
-        set_flag<FI::Z>(arg,!tmp);
-        set_flag<FI::N>(arg,UNSET);
-        set_flag<FI::H>(arg,SET);
-        set_flag<FI::C>(arg,UNSET);
+        set_flags<FLAG_OP::AND>(arg,0,0,false,tmp);
     }
     template<RI8 src> void and_a_r8(cfa arg){
         __and(arg,get_reg<src>(arg));
@@ -98,7 +99,7 @@ namespace instr_defs{
         __and(arg,val);
     }
     inline void and_a_n8(cfa arg){
-        __and(arg,arg.gb.immediate8());
+        __and(arg,immediate8(arg));
     }
     //  BIT
     template<BIT bit> void __bit(cfa arg, uint8_t reg){
@@ -122,10 +123,7 @@ namespace instr_defs{
     //  CP
     __always_inline void __cp(cfa arg, uint8_t cmp){
         auto tmp = get_reg<RI::A>(arg);
-        set_flag<FI::Z>(arg,tmp==cmp);
-        set_flag<FI::N>(arg,SET);
-        set_flag<FI::H>(arg,(tmp&0x0F)<(cmp&0x0F));
-        set_flag<FI::C>(arg,tmp<cmp);
+        set_flags<FLAG_OP::SUB>(arg,tmp,cmp,false,tmp-cmp);
     }
     template<RI8 src> void cp_a_r8(cfa arg){
         __cp(arg,get_reg<src>(arg));
@@ -135,7 +133,7 @@ namespace instr_defs{
         __cp(arg,val);
     }
     inline void cp_a_n8(cfa arg){
-        __cp(arg,arg.gb.immediate8());
+        __cp(arg,immediate8(arg));
     }
     //  CPL
     inline void cpl(cfa arg){
@@ -171,10 +169,8 @@ namespace instr_defs{
     }
     //  DEC
     __always_inline void __dec(cfa arg, uint8_t& reg){
-        set_flag<FI::H>(arg,(reg&0x0F)<1);
-        --reg;
-        set_flag<FI::Z>(arg,!reg);
-        set_flag<FI::N>(arg,SET);
+        uint8_t tmp = reg--;
+        set_flags<FLAG_OP::DEC>(arg,tmp,1,false,reg);
     }
     template<RI8 dest> void dec_r8(cfa arg){
         __dec(arg,get_reg<dest>(arg));
@@ -193,13 +189,12 @@ namespace instr_defs{
     }
     //  DI
     inline void di(cfa arg){
-        //  pushes the event to disable ime 5 cycles into the future as to skip the next instruction.
-        arg.gb.scheduler.add_event(5, {[&](){ arg.gb.ime = false; }, scheduler_event::DI});
+        arg.gb.set_ime(false);
     }
     //  EI
     inline void ei(cfa arg){
-        //  pushes the event to enable ime 5 cycles into the future as to skip the next instruction.
-        arg.gb.scheduler.add_event(5, {[&](){ arg.gb.ime = true; }, scheduler_event::EI});
+        //  ime is only set after the next instruction.
+        arg.gb.enable_ime_delayed();
     }
     //  HALT
     inline void halt(cfa arg){
@@ -207,10 +202,8 @@ namespace instr_defs{
     }
     //  INC
     __always_inline void __inc(cfa arg, uint8_t& val){
-        set_flag<FI::H>(arg,(val&0x0F)==0x0F);
-        ++val;
-        set_flag<FI::Z>(arg,!val);
-        set_flag<FI::N>(arg,UNSET);
+        uint8_t tmp = val++;
+        set_flags<FLAG_OP::INC>(arg,tmp,1,false,val);
     }
     template<RI8 dest> void inc_r8(cfa arg){
         __inc(arg,get_reg<dest>(arg));
@@ -229,7 +222,7 @@ namespace instr_defs{
     }
     //  JP
     inline void jp_n16(cfa arg){
-        get_reg<RI::PC>(arg) = arg.gb.immediate16();
+        get_reg<RI::PC>(arg) = immediate16(arg);
         arg.did_branch = true;
     }
     template<FI flag, BIT_VAL state> void jp_cc_n16(cfa arg){
@@ -242,7 +235,7 @@ namespace instr_defs{
     }
     //  JR
     inline void jr_e8(cfa arg){
-        get_reg<RI::PC>(arg)+=(int8_t)arg.gb.immediate8();
+        get_reg<RI::PC>(arg)+=(int8_t)immediate8(arg);
         arg.did_branch = true;
     }
     template<FI flag, BIT_VAL state>
@@ -255,16 +248,16 @@ namespace instr_defs{
         get_reg<dest>(arg)=get_reg<src>(arg);
     }
     template<RI8 dest> void ld_r8_n8(cfa arg){
-        get_reg<dest>(arg)=arg.gb.immediate8();
+        get_reg<dest>(arg)=immediate8(arg);
     }
     template<RI16 dest> void ld_r16_n16(cfa arg){
-        get_reg<dest>(arg)=arg.gb.immediate16();
+        get_reg<dest>(arg)=immediate16(arg);
     }
     template<RI8 src> void ld_pointer_hl_r8(cfa arg){
         arg.gb.mem.write(get_reg<RI::HL>(arg),get_reg<src>(arg));
     }
     inline void ld_pointer_hl_n8(cfa arg){
-        arg.gb.mem.write(get_reg<RI::HL>(arg),arg.gb.immediate8());
+        arg.gb.mem.write(get_reg<RI::HL>(arg),immediate8(arg));
     }
     template<RI8 dest> void ld_r8_pointer_hl(cfa arg){
         get_reg<dest>(arg)=arg.gb.mem.read(get_reg<RI::HL>(arg));
@@ -273,13 +266,13 @@ namespace instr_defs{
         arg.gb.mem.write(get_reg<dest_pointer>(arg),get_reg<RI::A>(arg));
     }
     inline void ld_pointer_n16_a(cfa arg){
-        arg.gb.mem.write(arg.gb.immediate16(),get_reg<RI::A>(arg));
+        arg.gb.mem.write(immediate16(arg),get_reg<RI::A>(arg));
     }
     template<RI16 src_pointer> void ld_a_pointer_r16(cfa arg){
         get_reg<RI::A>(arg)=arg.gb.mem.read(get_reg<src_pointer>(arg));
     }
     inline void ld_a_pointer_n16(cfa arg){
-        get_reg<RI::A>(arg)=arg.gb.mem.read(arg.gb.immediate16());
+        get_reg<RI::A>(arg)=arg.gb.mem.read(immediate16(arg));
     }
     inline void ld_pointer_hl_increment_a(cfa arg){
         arg.gb.mem.write(get_reg<RI::HL>(arg)++,get_reg<RI::A>(arg));
@@ -294,15 +287,16 @@ namespace instr_defs{
         get_reg<RI::A>(arg)=arg.gb.mem.read(get_reg<RI::HL>(arg)--);
     }
     inline void ld_sp_n16(cfa arg){
-        get_reg<RI::SP>(arg)=arg.gb.immediate16();
+        get_reg<RI::SP>(arg)=immediate16(arg);
     }
     inline void ld_pointer_n16_sp(cfa arg){
-        arg.gb.mem.write(arg.gb.immediate16(),get_reg<RI::SP>(arg));
-        arg.gb.mem.write(arg.gb.immediate16()+1,get_reg<RI::SP>(arg)>>8);
+        uint16_t adr = immediate16(arg);
+        arg.gb.mem.write(adr,get_reg<RI::SP>(arg));
+        arg.gb.mem.write(adr+1,get_reg<RI::SP>(arg)>>8);
     }
     inline void ld_hl_sp_e8(cfa arg){
         uint16_t sp = get_reg<RI::SP>(arg);
-        int8_t imm = arg.gb.immediate8();
+        int8_t imm = immediate8(arg);
         get_reg<RI::HL>(arg)=sp+imm;
         set_flag<FI::Z>(arg,UNSET);
         set_flag<FI::N>(arg,UNSET);
@@ -316,13 +310,13 @@ namespace instr_defs{
     }
     //  LDH
     inline void ldh_pointer_n8_a(cfa arg){
-        arg.gb.mem.write(0xFF00+arg.gb.immediate8(),get_reg<RI::A>(arg));
+        arg.gb.mem.write(0xFF00+immediate8(arg),get_reg<RI::A>(arg));
     }
     inline void ldh_pointer_c_a(cfa arg){
         arg.gb.mem.write(0xFF00+get_reg<RI::C>(arg),get_reg<RI::A>(arg));
     }
     inline void ldh_a_pointer_n8(cfa arg){
-        get_reg<RI::A>(arg)=arg.gb.mem.read(0xFF00+arg.gb.immediate8());
+        get_reg<RI::A>(arg)=arg.gb.mem.read(0xFF00+immediate8(arg));
     }
     inline void ldh_a_pointer_c(cfa arg){
         get_reg<RI::A>(arg)=arg.gb.mem.read(0xFF00+get_reg<RI::C>(arg));
@@ -332,10 +326,7 @@ namespace instr_defs{
     //  OR
     __always_inline void __or(cfa arg, uint8_t val){
         auto tmp = (get_reg<RI::A>(arg)|=val);
-        set_flag<FI::Z>(arg,!tmp);
-        set_flag<FI::N>(arg,UNSET);
-        set_flag<FI::H>(arg,UNSET);
-        set_flag<FI::C>(arg,UNSET);
+        set_flags<FLAG_OP::OR>(arg,0,0,false,tmp);
     }
     template<RI8 dest> void or_a_r8(cfa arg){
         __or(arg,get_reg<dest>(arg));
@@ -345,7 +336,7 @@ namespace instr_defs{
         __or(arg,val);
     }
     inline void or_a_n8(cfa arg){
-        __or(arg,arg.gb.immediate8());
+        __or(arg,immediate8(arg));
     }
     //  PUSH
     template<RI16 src> void push_r16(cfa arg){
@@ -398,7 +389,7 @@ namespace instr_defs{
     }
     inline void reti(cfa arg){
         ret(arg);
-        ei(arg);
+        arg.gb.set_ime(true);
     }
     //  RL
     __always_inline void __rl(cfa arg, uint8_t& reg){
@@ -561,16 +552,15 @@ namespace instr_defs{
     }
     //  STOP
     inline void stop(cfa arg){
-        //throw std::runtime_error("unimplemented instruction");
+        //  there's no joypad yet, so stop waits for any interrupt just like halt.
+        arg.gb.stopped = arg.gb.halted = true;
     }
     //  SBC
     __always_inline void __sbc(cfa arg, uint8_t val, bool carry){
         auto& tmp = get_reg<RI::A>(arg);
-        set_flag<FI::H>(arg,(tmp&0x0F)<(val&0x0F)+carry);
-        set_flag<FI::C>(arg,tmp<val+carry);
+        uint8_t lhs = tmp;
         tmp-=val+carry;
-        set_flag<FI::Z>(arg,!tmp);
-        set_flag<FI::N>(arg,SET);
+        set_flags<FLAG_OP::SUB>(arg,lhs,val,carry,tmp);
     }
     template<RI8 src> void sbc_a_r8(cfa arg){
         __sbc(arg,get_reg<src>(arg), get_flag<FI::C>(arg));
@@ -580,7 +570,7 @@ namespace instr_defs{
         __sbc(arg, val, get_flag<FI::C>(arg));
     }
     inline void sbc_a_n8(cfa arg){
-        __sbc(arg, arg.gb.immediate8(), get_flag<FI::C>(arg));
+        __sbc(arg, immediate8(arg), get_flag<FI::C>(arg));
     }
     //  SUB
     __always_inline void __sub(cfa arg, uint8_t val){
@@ -594,7 +584,7 @@ namespace instr_defs{
         __sub(arg, val);
     }
     inline void sub_a_n8(cfa arg){
-        __sub(arg, arg.gb.immediate8());
+        __sub(arg, immediate8(arg));
     }
     //  SWAP
     __always_inline void __swap(cfa arg, uint8_t& reg){
@@ -615,10 +605,7 @@ namespace instr_defs{
     //  XOR
     __always_inline void __xor(cfa arg, uint8_t reg){
         auto tmp = (get_reg<RI::A>(arg)^=reg);
-        set_flag<FI::Z>(arg,!tmp);
-        set_flag<FI::N>(arg,UNSET);
-        set_flag<FI::H>(arg,UNSET);
-        set_flag<FI::C>(arg,UNSET);
+        set_flags<FLAG_OP::OR>(arg,0,0,false,tmp);
     }
     template<RI8 src> void xor_a_r8(cfa arg){
         __xor(arg,get_reg<src>(arg));
@@ -628,6 +615,6 @@ namespace instr_defs{
         __xor(arg,val);
     }
     inline void xor_a_n8(cfa arg){
-        __xor(arg,arg.gb.immediate8());
+        __xor(arg,immediate8(arg));
     }
 };
\ No newline at end of file
@@ -1,14 +1,17 @@
 #pragma once
 #include<common_defs.h>
-#include<gameboy.h>
 #include<memory/memory.h>
 #include<array>
 #include<tuple>
 
+struct gameboy_t;
+
 struct cpu_function_argument_t{
-    cpu_function_argument_t(gameboy_t& gb): gb{gb} {}
+    cpu_function_argument_t(gameboy_t& gb, uint16_t operand=0): gb{gb}, operand{operand} {}
     gameboy_t& gb;
+    uint16_t operand;           //  immediate bytes, or the opcode following a 0xCB prefix.
     bool did_branch{false};
+    bool did_split{false};      //  a fused handler stopped early and already ticked what it ran.
 };
 using cfa = cpu_function_argument_t&;
 
@@ -31,7 +34,39 @@ using _instr_array = std::array<
     cpu_function_entry,
     INSTR_ARRAY_SIZE>;
 
+//  compact entry for the threaded dispatcher, label indexing its jump table.
+struct threaded_entry_t{
+    uint16_t label;     //  the opcode, 0x100 plus the opcode for the cb range or THREADED_INVALID.
+    uint8_t bytes;
+    uint8_t ticks;
+    uint8_t br_ticks;
+};
+static_assert(sizeof(threaded_entry_t) <= 8, "threaded entries should stay compact");
+constexpr uint16_t THREADED_INVALID = 0x200;
+using _threaded_array = std::array<
+    threaded_entry_t,
+    INSTR_ARRAY_SIZE>;
+
+//  a run of opcodes executed by a single handler, see instr_table::fused_range.
+struct fused_entry_t{
+    std::array<uint8_t,4> opcodes;
+    size_t count;
+    cpu_function_entry entry;   //  total length, summed ticks and the fused handler.
+};
+constexpr size_t FUSED_ARRAY_SIZE = 16;
+using _fused_array = std::array<
+    fused_entry_t,
+    FUSED_ARRAY_SIZE>;
+template<uint8_t... opcodes> struct fused_instr_t;
+
 namespace instr_table{
     extern const _instr_array noncb_range;
     extern const _instr_array cb_range; 
+    extern const _threaded_array threaded_noncb_range;
+    extern const _threaded_array threaded_cb_range;
+    extern const _fused_array fused_range;     //  longest runs first.
+    //  runs instructions until an event is due, the budget of t-cycles is spent, the cpu halts or the debugger pauses.
+    //  returns false on an invalid instruction, with pc left on it.
+    template<debug_policy policy>
+    bool run_threaded(gameboy_t& gb, size_t budget);
 }
\ No newline at end of file
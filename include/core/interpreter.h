@@ -29,6 +29,8 @@ union cpu_register_a_t{
 };
 
 enum class FLAG_INDEX{ Z,N,H,C };
+//  alu operations whose flags can be derived from their operands and result.
+enum class FLAG_OP:uint8_t{ NONE,ADD,SUB,AND,OR,INC,DEC };
 namespace RI{
     enum R8     { A,B,C,D,E,H,L };
     enum R16    { AF,BC,DE,HL,SP,PC };
@@ -50,6 +52,8 @@ struct cpu_register_bank_t{
         }
     }
     template<RI16 r> constexpr uint16_t& get(){
+        if constexpr(r == RI::AF)
+            materialize_flags();
         switch(r){
         case RI::AF:    return af._wide;
         case RI::BC:    return bc._wide;
@@ -61,6 +65,10 @@ struct cpu_register_bank_t{
     }
     template<FI f>
     constexpr bool get_flag(){
+#ifdef __LAZY_FLAGS__
+        if(lazy.op != FLAG_OP::NONE)
+            return compute_flag<f>();
+#endif
         switch(f){
         case FI::Z: return af._narrow._l.z != 0;
         case FI::N: return af._narrow._l.n != 0;
@@ -70,6 +78,7 @@ struct cpu_register_bank_t{
     }
     template<FI f>
     constexpr void set_flag(bool set){
+        materialize_flags();
         switch(f){
         case FI::Z: af._narrow._l.z = (set != 0); break;
         case FI::N: af._narrow._l.n = (set != 0); break;
@@ -77,7 +86,60 @@ struct cpu_register_bank_t{
         case FI::C: af._narrow._l.c = (set != 0); break;
         }
     }
+    //  sets every flag an alu operation affects. INC and DEC keep the current carry.
+    template<FLAG_OP op>
+    constexpr void set_flags(uint8_t lhs, uint8_t rhs, bool carry, uint8_t result){
+        if constexpr(op == FLAG_OP::INC || op == FLAG_OP::DEC)
+            carry = get_flag<FI::C>();
+        lazy = { op, lhs, rhs, result, carry };
+#ifndef __LAZY_FLAGS__
+        materialize_flags();
+#endif
+    }
+    //  writes the flags of the last recorded alu operation into F.
+    constexpr void materialize_flags(){
+        if(lazy.op == FLAG_OP::NONE)
+            return;
+        af._narrow._l.z = compute_flag<FI::Z>();
+        af._narrow._l.n = compute_flag<FI::N>();
+        af._narrow._l.h = compute_flag<FI::H>();
+        af._narrow._l.c = compute_flag<FI::C>();
+        lazy.op = FLAG_OP::NONE;
+    }
 private:
+    template<FI f>
+    constexpr bool compute_flag(){
+        const auto& l = lazy;
+        switch(f){
+        case FI::Z: return !l.result;
+        case FI::N: return l.op == FLAG_OP::SUB || l.op == FLAG_OP::DEC;
+        case FI::H:
+            switch(l.op){
+            case FLAG_OP::ADD:  return (l.lhs&0x0F)+(l.rhs&0x0F)+l.carry > 0x0F;
+            case FLAG_OP::SUB:  return (l.lhs&0x0F) < (l.rhs&0x0F)+l.carry;
+            case FLAG_OP::AND:  return true;
+            case FLAG_OP::INC:  return (l.lhs&0x0F) == 0x0F;
+            case FLAG_OP::DEC:  return (l.lhs&0x0F) == 0;
+            default:            return false;
+            }
+        case FI::C:
+            switch(l.op){
+            case FLAG_OP::ADD:  return l.lhs+l.rhs+l.carry > 0xFF;
+            case FLAG_OP::SUB:  return l.lhs < l.rhs+l.carry;
+            case FLAG_OP::INC:
+            case FLAG_OP::DEC:  return l.carry;
+            default:            return false;
+            }
+        }
+        return false;
+    }
+    struct lazy_flags_t{
+        FLAG_OP op;
+        uint8_t lhs, rhs, result;
+        bool carry;
+    };
     cpu_register_t bc{0},de{0},hl{0},sp{0},pc{0};
     cpu_register_a_t af{0};
+    lazy_flags_t lazy{FLAG_OP::NONE,0,0,0,false};
+    friend struct jit_t;
 };
\ No newline at end of file
@@ -0,0 +1,78 @@
+/*
+    translates hot basic blocks from rom into x86-64 machine code.
+*/
+#pragma once
+#include<common_defs.h>
+#include<core/block_cache.h>
+#include<vector>
+#include<memory>
+
+struct gameboy_t;
+
+//  small assembler for the handful of x86-64 encodings the translator needs.
+struct x64_emitter_t{
+    enum REG{ RAX=0,RCX=1,RDX=2,RBX=3,RSP=4,RBP=5,RSI=6,RDI=7,R12=12,R13=13 };
+    //  the x86 alu operations, their "op al, r/m8" and "op al, imm8" forms are 0x02 and 0x04 past these.
+    enum ALU{ ADD=0x00,OR=0x08,AND=0x20,SUB=0x28,XOR=0x30,CMP=0x38 };
+    void bytes(std::initializer_list<uint8_t> b){ code.insert(code.end(), b); }
+    void imm16(uint16_t v){ bytes({(uint8_t)v,(uint8_t)(v>>8)}); }
+    void imm32(uint32_t v){ for(size_t i = 0; i < 4; ++i) code.push_back(v>>(i*8)); }
+    void imm64(uint64_t v){ for(size_t i = 0; i < 8; ++i) code.push_back(v>>(i*8)); }
+    void mov_r64_imm64(REG r, uint64_t v);
+    //  accesses through [r12+disp32], which always points at the register bank.
+    void mov_bank_imm8(int32_t disp, uint8_t v);
+    void mov_bank_imm16(int32_t disp, uint16_t v);
+    void mov_al_bank(int32_t disp);
+    void mov_bank_al(int32_t disp);
+    void mov_ax_bank(int32_t disp);
+    void mov_bank_ax(int32_t disp);
+    void inc_bank16(int32_t disp);
+    void dec_bank16(int32_t disp);
+    void mov_cl_bank(int32_t disp);
+    void mov_bank_cl(int32_t disp);
+    void movzx_edx_bank16(int32_t disp);
+    void alu_al_bank(ALU op, int32_t disp);
+    void alu_al_imm8(ALU op, uint8_t v);
+    void cmp_bank_imm8(int32_t disp, uint8_t v);
+    void test_bank_imm8(int32_t disp, uint8_t v);
+    //  accesses through [rbx+disp32], which always points at the cpu_function_argument_t.
+    void mov_arg_imm8(int32_t disp, uint8_t v);
+    void mov_arg_imm16(int32_t disp, uint16_t v);
+    void cmp_arg_imm8(int32_t disp, uint8_t v);
+    //  accesses through [r13], which always points at the scheduler cycle counter.
+    void add_cycles_imm32(uint32_t v);
+    void add_cycles_rax();
+    void mov_rax_cycles();
+    size_t jcc_rel32(uint8_t cc);  //  returns the offset of the displacement to patch.
+    size_t jmp_rel32();
+    void patch_rel32(size_t at, size_t target);
+    std::vector<uint8_t> code;
+};
+
+struct jit_t{
+    static constexpr size_t HOT_THRESHOLD = 16;
+    static constexpr size_t CODE_BUFFER_SIZE = 4*1024*1024;
+    static bool is_supported();
+    //  compiles a rom block, returning false when it can't be translated.
+    bool compile(gameboy_t& gb, basic_block_t& block);
+    //  forgets every translation, the blocks pointing into the buffer have to be dropped first.
+    void reset(){ used = 0; }
+protected:
+    struct code_buffer_deleter{ void operator()(uint8_t* p) const; };
+    bool is_native(const predecoded_instr_t& instr);
+    //  loads and stores through a mapped page run inline, the others call their handler.
+    bool is_memory(const predecoded_instr_t& instr);
+    bool is_conditional_branch(const predecoded_instr_t& instr);
+    void emit_native(gameboy_t& gb, x64_emitter_t& e, const predecoded_instr_t& instr, uint16_t next_pc);
+    void emit_alu(gameboy_t& gb, x64_emitter_t& e, const predecoded_instr_t& instr);
+    void emit_memory(gameboy_t& gb, x64_emitter_t& e, const predecoded_instr_t& instr);
+    //  adds the cycles of whichever way it went itself.
+    void emit_branch(gameboy_t& gb, x64_emitter_t& e, const predecoded_instr_t& instr, uint16_t next_pc);
+    void emit_call(gameboy_t& gb, x64_emitter_t& e, const predecoded_instr_t& instr);
+    //  offsets into the register bank of F and of the pending lazy flag operation.
+    static int32_t f_offset(gameboy_t& gb);
+    static int32_t lazy_op_offset(gameboy_t& gb);
+    std::unique_ptr<uint8_t, code_buffer_deleter> buffer;
+    size_t used{0};
+    bool failed{false};
+};
\ No newline at end of file
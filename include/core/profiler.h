@@ -0,0 +1,37 @@
+/*
+    counts executions and emulated cycles per opcode and per memory region the code runs from.
+*/
+#pragma once
+#include<common_defs.h>
+#include<disassemble/disassemble.h>
+#include<array>
+#include<ostream>
+
+struct profile_entry_t{
+    size_t executions{0};
+    size_t cycles{0};
+};
+
+struct profiler_t{
+    static constexpr size_t MEMORY_TYPE_COUNT = (size_t)memory_type::HRAM+1;
+    //  cb_opcode is only used when opcode is the 0xCB prefix.
+    void record(uint16_t adr, uint8_t opcode, uint8_t cb_opcode, size_t cycles){
+        auto& entry = opcode == 0xCB ? cb[cb_opcode] : noncb[opcode];
+        auto& region = regions[(size_t)disassembler_t::get_memory_type(adr)];
+        ++entry.executions;
+        entry.cycles += cycles;
+        ++region.executions;
+        region.cycles += cycles;
+    }
+    void reset();
+    void export_csv(std::ostream& os) const;
+    void export_json(std::ostream& os) const;
+    const auto& get_noncb() const { return noncb; }
+    const auto& get_cb() const { return cb; }
+    const auto& get_regions() const { return regions; }
+    static const char* get_region_name(size_t region);
+protected:
+    std::array<profile_entry_t,256> noncb;
+    std::array<profile_entry_t,256> cb;
+    std::array<profile_entry_t,MEMORY_TYPE_COUNT> regions;
+};
\ No newline at end of file
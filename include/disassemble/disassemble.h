@@ -28,8 +28,9 @@ struct disassembler_t{
     static bool is_call(uint8_t opc);
     static bool is_conditional(uint8_t opc);
     static bool is_labelifyable(uint8_t opc);
-    memory_type get_memory_type(uint16_t adr);
+    static memory_type get_memory_type(uint16_t adr);
     static std::string get_memory_region_string(uint16_t adr);
+    static std::string get_opcode_name(uint8_t opc, bool cb);  //  mnemonic with n8, n16 and e8 for the operands.
 protected:
     std::unordered_map<uint16_t, std::string> labels;
     std::string labelify_opc(uint8_t opc, uint16_t offset, uint16_t imm);
@@ -12,10 +12,14 @@ struct dbg_window{
     static float size_x,size_y;
     static void on_pause();
     static void on_play();
+    //  the emulator only runs its instrumented core while the window is open.
+    static void attach();
+    static void detach();
 protected:
     static void draw_reg_subwindow();
     static void draw_disasm_subwindow();
     static void draw_control_subwindow();
+    static void draw_profiler_window();
     static void disassemble(uint16_t adr=0);
     static gameboy_t* gameboy;
     static inline uint16_t upper_viewable_rom_address{0x7FFF};
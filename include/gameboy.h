@@ -5,24 +5,84 @@
 #include<common_defs.h>
 #include<scheduler.h>
 #include<memory/memory.h>
+#include<timer/timer.h>
+#include<ppu/ppu.h>
 #include<core/interpreter.h>
+#include<core/block_cache.h>
+#include<core/jit.h>
+#include<core/profiler.h>
 #include<deque>
 
+enum class cpu_core{
+    INTERPRETER,    //  decodes every instruction through the opcode tables.
+    BLOCK_CACHE,    //  executes predecoded basic blocks.
+    JIT,            //  translates hot rom blocks to x86-64, falling back to BLOCK_CACHE elsewhere.
+    THREADED        //  dispatches through compact tables, each handler jumping to the next.
+};
+
 struct gameboy_t{
+    static constexpr size_t THREADED_SLICE = 456;   //  t-cycles the threaded core runs per update, one scanline.
+    static constexpr size_t CYCLES_PER_FRAME = 70224;
     gameboy_t();
     void update();
-    void load_rom(const std::string& path){ mem.load_rom(path); }
+    //  batch entry points, taking the lock once and only returning on the deadline or a debugger pause.
+    void run_for_cycles(size_t n);
+    void run_until_vblank();    //  runs until the ppu enters vblank, or for a frame while the lcd is off.
+    void load_rom(const std::string& path);
+    //  skips the boot rom on the next load, starting at 0x0100 with the state it leaves behind.
+    void set_fast_boot(bool enable){ fast_boot = enable; }
+    //  the scanline engine unless a rom needs registers changed mid line to show up.
+    void set_ppu_engine(ppu_engine engine){ ppu.set_engine(engine); }
+    //  wakes from halt and jumps to the highest priority pending interrupt, between instructions only.
     void handle_interrupts();
-    uint8_t immediate8();
-    uint16_t immediate16();
+    void set_ime(bool enable){
+        ime = enable;
+        ei_delay = false;
+        update_interrupt_check();
+    }
+    void enable_ime_delayed(){
+        ei_delay = !ime;
+        update_interrupt_check();
+    }
+    //  called whenever ime, the ei delay or ie & if change.
+    void update_interrupt_check(){ interrupt_check = (ime && mem.get_pending_interrupts()) || ei_delay; }
+    //  both may clear the block cache, so they wait for the emulation thread to be between steps.
+    void set_cpu_core(cpu_core core);
+    //  counts every executed instruction, see core/profiler.h. translation, fusion and idle loop skipping are off meanwhile.
+    void set_profiling(bool enable);
+    bool is_profiling(){ return profiling; }
+    //  switches between the uninstrumented and the instrumented core at the next step, without a reset.
+    void set_debug_policy(debug_policy policy);
+    debug_policy get_debug_policy(){ return policy; }
+    profiler_t profiler;
     scheduler_t scheduler;
+    block_cache_t blocks;   //  constructed ahead of mem, whose constructor already writes to memory.
+    timer_unit_t timer{this};
+    ppu_t ppu{this};
     memory_t mem{this};
     cpu_register_bank_t regs;
     bool ime{false};
+    bool ei_delay{false};       //  ei ran, ime gets set at the next instruction boundary.
+    bool interrupt_check{false};    //  the one flag the cores test between instructions.
     bool halted{false},stopped{false};
+    jit_t jit;
 protected:
     void init();
-    void fetch_decode_execute();
+    void step(size_t budget);
+    template<debug_policy policy> void step(size_t budget);
+    template<debug_policy policy> void fetch_decode_execute();
+    template<debug_policy policy> void execute_block(size_t budget);
+    template<debug_policy policy> bool execute_predecoded(const basic_block_t& block);    //  returns false when it left the block early.
+    void skip_idle_loop(const basic_block_t& block, size_t iteration, size_t limit);
+    void dbg_instruction_hook(uint16_t prev_pc, uint8_t opcode, size_t instr_size, uint16_t operand, bool did_branch);
+    void update_fusion(){
+        //  translated code can't stop halfway through a fused handler.
+        blocks.set_fusion(core == cpu_core::BLOCK_CACHE && !profiling);
+    }
+    cpu_core core{cpu_core::BLOCK_CACHE};
+    bool profiling{false};
+    bool fast_boot{false};
+    debug_policy policy{debug_policy::FAST};
     size_t fps{0};
     //  debugging.
     void dbg_reset();
@@ -37,4 +97,7 @@ protected:
     std::function<void(uint16_t, uint16_t)> dbg_enter_call_callbk;
     std::function<void()> dbg_ret_from_call_callbk;
     friend struct dbg_window;
+    friend struct jit_t;
+    template<debug_policy policy> friend bool instr_table::run_threaded(gameboy_t& gb, size_t budget);
+    template<uint8_t... opcodes> friend struct fused_instr_t;
 };
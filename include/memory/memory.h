@@ -1,11 +1,14 @@
 #pragma once
 #include<common_defs.h>
 #include<memory/cart.h>
+#include<memory/watchpoints.h>
+#include<memory/rom_image.h>
 #include<vector>
 #include<string>
 #include<functional>
 #include<stdexcept>
 #include<memory>
+#include<variant>
 
 struct gameboy_t;
 
@@ -14,15 +17,47 @@ struct banks_t{
     void alloc(size_t size){ banks = std::vector<t>(size); }
     void copy_from_vec(const std::vector<t>& vec){ banks = vec; }
     t& get(){ return banks[index]; }
-    void set_active(size_t index){ index = index; }
+    //  bank numbers past the end wrap around, as the unused high bits do on the cartridge.
+    void set_active(size_t index){ if(banks.size()) this->index = index%banks.size(); }
     size_t get_size(){ return banks.size(); }
+    size_t get_index(){ return index; }
 protected:
     size_t index{0};
     std::vector<t> banks{1};
 };
 
+struct mbc_t;
+
+//  bank controllers, turning writes to the rom area into bank selections on the mbc_t.
+struct mbc_none_t{
+    void rom_write(mbc_t& mbc, uint16_t adr, uint8_t val){}
+};
+
+struct mbc1_t{
+    void rom_write(mbc_t& mbc, uint16_t adr, uint8_t val);
+    uint8_t rom_bank{1};
+    uint8_t secondary_bank_index{0};
+    bool ram_mode{false};
+};
+
+struct mbc3_t{
+    void rom_write(mbc_t& mbc, uint16_t adr, uint8_t val);
+    std::array<uint8_t,5> rtc{0};   //  seconds, minutes, hours, day low, day high and flags.
+};
+
+struct mbc5_t{
+    void rom_write(mbc_t& mbc, uint16_t adr, uint8_t val);
+    uint16_t rom_bank{1};
+};
+
+using mbc_controller_t = std::variant<mbc_none_t, mbc1_t, mbc3_t, mbc5_t>;
+
+//  cartridge and banked memory. The controller is picked at rom load and dispatched statically.
 struct mbc_t{
-    virtual void rom_write(uint16_t adr, uint8_t val) = 0;
+    mbc_t(mbc_controller_t controller): controller{controller} {}
+    void rom_write(uint16_t adr, uint8_t val){ 
+        std::visit([&](auto& c){ c.rom_write(*this, adr, val); }, controller); 
+    }
     uint8_t read_rom(uint16_t adr);
     uint8_t read_ram(uint16_t adr);
     uint8_t read_wram(uint16_t adr);
@@ -32,40 +67,88 @@ struct mbc_t{
     void write_vram(uint16_t adr, uint8_t val);
     void strap_boot_rom();
     void unstrap_boot_rom();
-    void load_rom(const std::vector<char>& rom_data);
+    void load_rom(std::shared_ptr<const rom_image_t> image);
+    size_t get_rom_bank(){ return rom_bank; }
+    size_t get_rom_bank_count(){ return rom->get_bank_count(); }
+    bool is_cgb(){ return info.cgb_flag&0x80; }
+    const uint8_t* get_rom_page(uint16_t adr);  //  host memory behind a rom address, the boot rom while it's mapped.
+    uint8_t* get_page(uint16_t adr);            //  host memory behind a vram, cart ram or banked wram address.
+    //  used by the controllers, the page tables are remapped after every rom write.
+    void select_rom_bank(size_t bank){ rom_bank = bank%rom->get_bank_count(); }
+    void select_ram_bank(size_t bank){ ram_banks.set_active(bank); }
+    void enable_ram(bool enable){ ram_enabled = enable; }
+    void map_register(uint8_t* reg){ mapped_register = reg; }  //  shows a register instead of cart ram, null maps the ram back.
 protected:
-    rom_bank_t rom1, unbinded_rom{0};
-    banks_t<rom_bank_t> rom2;
+    mbc_controller_t controller;
+    std::shared_ptr<const rom_image_t> rom;
+    size_t rom_bank{1};         //  bank mapped at 0x4000, bank 0 included.
+    const std::array<uint8_t,0x100>* boot_rom{nullptr};    //  the process wide copy while it's mapped.
     banks_t<ram_bank_t> ram_banks;
     banks_t<std::array<uint8_t,0x1000>> wram_banks;
     banks_t<std::array<uint8_t,0x2000>> vram_banks;
+    bool ram_enabled{true};
+    uint8_t* mapped_register{nullptr};
     rom_info_t info;
 };
 
-struct mbc_none_t: mbc_t{
-    void rom_write(uint16_t adr, uint8_t val) final;
-};
-
-struct mbc1_t: mbc_t{
-    void rom_write(uint16_t adr, uint8_t val) final;
-    bool ram_enabled{false};
-    size_t secondary_bank_index{0};
-    bool ram_mode{false};
-};
-
 static inline const uint16_t IE_ADR = 0xFFFF;
 static inline const uint16_t IF_ADR = 0xFF0F;
 
+//  the bits of IE and IF, in order of priority.
+enum class interrupt_bit{
+    VBLANK      = 0b1,
+    LCD_STAT    = 0b10,
+    TIMER       = 0b100,
+    SERIAL      = 0b1000,
+    JOYPAD      = 0b10000
+};
+
 struct memory_t{
+    static constexpr size_t OAM_DMA_CYCLES = 640;       //  160 machine cycles, one per byte.
+    static constexpr size_t HDMA_BLOCK_CYCLES = 32;     //  the cpu stalls this long per 16 bytes.
     memory_t(gameboy_t* gb): gb{gb} { 
         if(gb == nullptr)
             throw std::runtime_error("invalid pointer in memory constructor.");
-        write(0xFF44, 0x90);
     }
-    uint8_t read(uint16_t adr);
-    void write(uint16_t adr, uint8_t val);
-    void load_rom(const std::string& path);
+    //  dispatch on the active policy, cores that already know it call the instantiations directly.
+    uint8_t read(uint16_t adr){ 
+        return policy == debug_policy::FAST ? read<debug_policy::FAST>(adr) : read<debug_policy::INSTRUMENTED>(adr); 
+    }
+    void write(uint16_t adr, uint8_t val){
+        if(policy == debug_policy::FAST)
+            write<debug_policy::FAST>(adr, val);
+        else
+            write<debug_policy::INSTRUMENTED>(adr, val);
+    }
+    template<debug_policy policy> uint8_t read(uint16_t adr);
+    template<debug_policy policy> void write(uint16_t adr, uint8_t val);
+    void set_debug_policy(debug_policy policy){ this->policy = policy; }
+    //  reads the 1 or 2 immediate bytes of an instruction, straight from the mapped rom bank when they lie in one.
+    uint16_t read_operand(uint16_t adr, size_t bytes);
+    //  fast boot leaves the boot rom unmapped, with io and vram as the boot rom would have left them.
+    void load_rom(const std::string& path, bool fast_boot = false);
     const std::string& get_rom_path(){ return rom_path; }
+    size_t get_rom_bank(uint16_t adr){ return adr < 0x4000 || adr >= 0x8000 ? 0 : mbc->get_rom_bank()+1; }
+    bool is_boot_rom_bound(){ return boot_rom_bound; }
+    //  everything but io and hram reads 0xFF meanwhile, predecoded code included.
+    bool is_oam_dma_active(){ return oam_dma_active; }
+    //  sends writes to a page holding cached code through the slow path, which invalidates the blocks.
+    void unmap_write_page(uint16_t adr){ write_pages[adr>>8] = nullptr; }
+    //  puts a page back on the fast path once its cached code is gone.
+    void remap_write_page(uint16_t adr){ remap(adr>>8, adr>>8); }
+    void request_interrupt(interrupt_bit bit);
+    void acknowledge_interrupt(uint8_t bit);    //  clears the bit in IF once the cpu jumped to its vector.
+    //  ie & if, kept up to date on every write to either.
+    uint8_t get_pending_interrupts(){ return pending_interrupts; }
+    //  for the ppu, which reads them directly.
+    const uint8_t* get_vram(){ return mbc->get_page(0x8000); }
+    const uint8_t* get_oam(){ return oam.data(); }
+    //  handler of the OAM_DMA event.
+    void finish_oam_dma();
+    //  called by the ppu on entering hblank, moves the next 16 bytes of an hblank dma.
+    void on_hblank();
+    //  registers whose value changes with time rather than through writes or scheduled events.
+    static bool is_time_dependent(uint16_t adr){ return adr == 0xFF04 || adr == 0xFF05; }
     gameboy_t* gb;
     //  debug members and callbacks
     uint8_t debug_read(uint16_t adr); //  reads for the debugger to use.
@@ -73,22 +156,43 @@ struct memory_t{
     std::function<void()> dbg_unbind_bootrom_callbk;
     std::function<void(uint16_t)> dbg_read_breakpoint_callbk;
     std::function<void(uint16_t, uint8_t)> dbg_write_breakpoint_callbk;
-    std::unordered_map<uint16_t, bool> dbg_read_breakpoints;
-    std::unordered_map<uint16_t, bool> dbg_write_breakpoints;
+    watchpoints_t dbg_read_breakpoints;
+    watchpoints_t dbg_write_breakpoints;
 protected:
     void allocate_mbc_type(uint8_t);
+    //  rebuilds the page tables after a bank switch or the boot rom being (un)mapped.
+    void remap(size_t first_page = 0x00, size_t last_page = 0xFF);
     void bind_boot_rom();
+    void apply_post_boot_state();
     void unbind_boot_rom();
     void write_io(uint16_t adr, uint8_t val);
     uint8_t read_io(uint16_t adr);
+    void update_pending_interrupts();
+    void start_oam_dma(uint8_t page);
+    void write_hdma(uint16_t adr, uint8_t val);
+    void copy_hdma_block();
+    //  copies from the mapped page at once, byte by byte through the debug reads where it isn't mapped.
+    void read_block(uint16_t src, uint8_t* out, size_t len);
     bool boot_rom_bound{false};
+    debug_policy policy{debug_policy::FAST};
     std::unique_ptr<mbc_t> mbc;
+    //  host pointers to every 256 byte page, null where io, oam or mbc control need the slow path.
+    std::array<const uint8_t*,0x100> read_pages{nullptr};
+    std::array<uint8_t*,0x100> write_pages{nullptr};
+    friend struct jit_t;    //  inlines the page table lookups.
     std::array<uint8_t,0x1000> wram{0};
-    std::array<uint8_t,0x9F> oam{0};
+    std::array<uint8_t,0xA0> oam{0};
     std::array<uint8_t,0x7F> io_regs{0};
     std::array<uint8_t,0x5F> illegal{0};
     std::array<uint8_t,0x7E> hram{0};
     uint8_t ie{0};
+    uint8_t pending_interrupts{0};
     std::string rom_path;
-    size_t div_timestamp{0};
+    //  the cpu only reaches io and hram while oam dma runs.
+    bool oam_dma_active{false};
+    uint8_t oam_dma_page{0};
+    //  cgb vram dma, addresses as written to HDMA1-4.
+    uint16_t hdma_src{0}, hdma_dst{0};
+    bool hdma_active{false};
+    uint8_t hdma_status{0xFF};  //  what HDMA5 reads, the blocks left minus one while active.
 };
\ No newline at end of file
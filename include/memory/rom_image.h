@@ -0,0 +1,27 @@
+/*
+    read only rom images, mapped from disk once and shared by every instance running the same rom.
+*/
+#pragma once
+#include<common_defs.h>
+#include<memory/cart.h>
+#include<string>
+#include<vector>
+#include<memory>
+
+struct rom_image_t{
+    //  returns the image already open for the file, or maps it. Throws when the file can't be read.
+    static std::shared_ptr<const rom_image_t> open(const std::string& path);
+    rom_image_t(const rom_image_t&) = delete;
+    rom_image_t& operator=(const rom_image_t&) = delete;
+    ~rom_image_t();
+    const uint8_t* data() const { return base; }
+    size_t size() const { return length; }
+    size_t get_bank_count() const { return length/sizeof(rom_bank_t); }
+    const uint8_t* get_bank(size_t bank) const { return base+bank*sizeof(rom_bank_t); }
+protected:
+    rom_image_t() = default;
+    const uint8_t* base{nullptr};
+    size_t length{0};
+    size_t mapped_length{0};        //  0 when the image lives in the owned buffer instead.
+    std::vector<uint8_t> owned;     //  files that aren't a whole number of banks get copied and padded.
+};
\ No newline at end of file
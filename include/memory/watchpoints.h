@@ -0,0 +1,25 @@
+/*
+    read and write watchpoints, looked up through a bitmap on every memory access.
+*/
+#pragma once
+#include<common_defs.h>
+#include<array>
+#include<vector>
+#include<utility>
+
+struct watchpoints_t{
+    //  arms every address of the inclusive range.
+    void add(uint16_t from, uint16_t to);
+    void add(uint16_t adr){ add(adr, adr); }
+    void remove(uint16_t adr);  //  drops every range containing the address.
+    void clear();
+    bool any() const { return armed; }
+    bool contains(uint16_t adr) const { return (bits[adr>>6]>>(adr&0x3F))&1; }
+    //  the ranges as added, for the debugger to list.
+    const std::vector<std::pair<uint16_t,uint16_t>>& get_ranges() const { return ranges; }
+protected:
+    void rebuild();
+    std::array<uint64_t,0x10000/64> bits{0};    //  8 KB, one bit per address.
+    std::vector<std::pair<uint16_t,uint16_t>> ranges;
+    bool armed{false};
+};
\ No newline at end of file
@@ -0,0 +1,37 @@
+/*
+    dot by dot mode 3, run lazily up to the current cycle before any write that could change what it draws.
+*/
+#pragma once
+#include<common_defs.h>
+#include<array>
+
+struct ppu_t;
+
+struct pixel_fifo_t{
+    static constexpr size_t FETCH_DOTS = 6;     //  tile id, low and high bitplane, 2 dots each.
+    static constexpr size_t SPRITE_DOTS = 6;    //  the background fetcher stalls this long per sprite.
+    void start_line(ppu_t& ppu);
+    //  advances up to the given number of dots, stopping once the line is out.
+    void run(ppu_t& ppu, size_t dots);
+    bool is_done(){ return lx == 160; }
+    size_t get_dots(){ return dots; }           //  dots spent on the line so far, the length of mode 3 once done.
+    size_t get_min_remaining(){ return 160-lx+discard; }
+protected:
+    struct sprite_pixel_t{
+        uint8_t color;
+        uint8_t attr;
+    };
+    void fetch_tile(ppu_t& ppu);
+    void fetch_sprite(ppu_t& ppu, const uint8_t* sprite);
+    void push_pixel(ppu_t& ppu);
+    std::array<uint8_t,8> bg;
+    size_t bg_head{8};                          //  8 when empty, the fetcher only pushes into an empty fifo.
+    std::array<sprite_pixel_t,8> sprites{};     //  indexed from the next pixel out.
+    std::array<uint8_t,10> line_sprites;        //  oam indices on this line, by x.
+    size_t sprite_count{0}, next_sprite{0};
+    size_t dots{0}, stall{0}, fetch_dots{0};
+    uint8_t fetch_x{0};                         //  tile column of the next fetch.
+    uint8_t lx{160};
+    uint8_t discard{0};                         //  pixels scx&7, or a window left of the screen, drops from the first tile.
+    bool window{false};
+};
\ No newline at end of file
@@ -0,0 +1,23 @@
+/*
+    tile decoding and palette expansion, in scalar, sse2 and avx2 variants picked at runtime.
+*/
+#pragma once
+#include<common_defs.h>
+
+enum class pixel_isa{
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+struct pixel_kernels_t{
+    //  16 bytes of 2bpp tile data to 64 color indices, row by row.
+    void (*decode_tile)(const uint8_t* data, uint8_t* out);
+    //  maps color indices through a 4 entry rgba8888 palette.
+    void (*expand)(const uint8_t* indices, const uint32_t* palette, uint32_t* out, size_t count);
+    pixel_isa isa;
+    //  the fastest variant the host supports, checked once.
+    static const pixel_kernels_t& get();
+    //  a specific variant, falling back to scalar when the host lacks it.
+    static const pixel_kernels_t& get(pixel_isa isa);
+};
\ No newline at end of file
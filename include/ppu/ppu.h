@@ -0,0 +1,95 @@
+/*
+    ppu. Mode changes are scheduler events, mode 3 is drawn by either engine.
+*/
+#pragma once
+#include<common_defs.h>
+#include<scheduler_trait.h>
+#include<ppu/tile_cache.h>
+#include<ppu/pixel_kernels.h>
+#include<ppu/pixel_fifo.h>
+#include<ppu/sprite_index.h>
+#include<array>
+
+struct gameboy_t;
+
+enum class ppu_mode{
+    HBLANK,
+    VBLANK,
+    OAM_SCAN,
+    TRANSFER
+};
+
+enum class ppu_engine{
+    SCANLINE,   //  draws the whole line at once when mode 3 ends.
+    FIFO        //  pushes pixels dot by dot, for roms that change registers mid line.
+};
+
+struct ppu_t: scheduler_component_trait<ppu_t>{
+    static constexpr size_t WIDTH = 160, HEIGHT = 144;
+    static constexpr size_t LINE_CYCLES = 456, OAM_SCAN_CYCLES = 80, TRANSFER_CYCLES = 172;
+    static constexpr size_t LINE_COUNT = 154;
+    //  rgba8888 of the 4 dmg shades, lightest first.
+    static constexpr std::array<uint32_t,4> SHADES{0xFFFFFFFF, 0xFFAAAAAA, 0xFF555555, 0xFF000000};
+    ppu_t(gameboy_t* gb): gb{gb} {}
+    //  handler of the PPU event, moves on to the next mode.
+    void update();
+    //  0xFF40 to 0xFF4B.
+    uint8_t read(uint16_t adr);
+    void write(uint16_t adr, uint8_t val);
+    //  called ahead of the write, so the fifo draws what came before it.
+    void on_vram_write(uint16_t adr){
+        sync();
+        if(adr < 0x9800)
+            tiles.invalidate(adr);
+    }
+    void on_oam_write(uint16_t adr, uint8_t val);
+    //  called once a dma replaced all of oam.
+    void on_oam_dma();
+    //  brings the fifo up to the current cycle, a no-op for the scanline engine.
+    void sync();
+    //  the lcd as the boot rom leaves it, on and at the start of a frame.
+    void apply_post_boot_state();
+    //  rgba8888, row by row.
+    const std::array<uint32_t,WIDTH*HEIGHT>& get_framebuffer(){ return framebuffer; }
+    size_t get_frame_count(){ return frame_count; }
+    ppu_mode get_mode(){ return mode; }
+    //  takes effect from the next line.
+    void set_engine(ppu_engine engine){ this->engine = engine; }
+    ppu_engine get_engine(){ return engine; }
+    gameboy_t* gb;
+protected:
+    bool is_enabled(){ return lcdc&0x80; }
+    void enter_mode(ppu_mode mode, size_t cycles);
+    void start_line();
+    //  the stat interrupt fires on the rising edge of the or of all its enabled sources.
+    void update_stat_line();
+    //  the sprites of the current line, ordered by x with ties going to the lower entry.
+    const sprite_index_t::line_t& select_sprites();
+    void render_scanline();
+    //  background and window leave color indices, the sprites need them for their priority.
+    void render_background(uint8_t* color);
+    void render_window(uint8_t* color);
+    void render_sprites(uint32_t* line, const uint8_t* color);
+    //  the 4 colors of a palette register as rgba.
+    std::array<uint32_t,4> get_palette(uint8_t reg){
+        return {SHADES[reg&0b11], SHADES[(reg>>2)&0b11], SHADES[(reg>>4)&0b11], SHADES[reg>>6]};
+    }
+    //  lcdc bit 4 picks between tiles 0-255 and tiles 256+-128.
+    size_t get_tile_index(uint8_t id){ return lcdc&0x10 ? id : 256+(int8_t)id; }
+    const pixel_kernels_t* kernels{&pixel_kernels_t::get()};
+    tile_cache_t tiles;
+    pixel_fifo_t fifo;
+    sprite_index_t sprite_index;
+    ppu_engine engine{ppu_engine::SCANLINE};
+    bool fifo_line{false};      //  the engine latched for the current line.
+    uint64_t transfer_stamp{0}; //  the cycle mode 3 started at.
+    std::array<uint32_t,WIDTH*HEIGHT> framebuffer{0};
+    size_t frame_count{0};
+    ppu_mode mode{ppu_mode::HBLANK};
+    uint64_t mode_stamp{0};     //  the cycle the current mode ends at.
+    bool stat_line{false};
+    uint8_t window_line{0};     //  lines of the window drawn so far this frame.
+    uint8_t lcdc{0}, stat{0}, scy{0}, scx{0}, ly{0}, lyc{0};
+    uint8_t bgp{0}, obp0{0}, obp1{0}, wy{0}, wx{0};
+    friend struct pixel_fifo_t;
+};
\ No newline at end of file
@@ -0,0 +1,31 @@
+/*
+    the sprites of every line, kept up to date on oam writes instead of searched for in mode 2.
+*/
+#pragma once
+#include<common_defs.h>
+#include<array>
+
+struct sprite_index_t{
+    static constexpr size_t LINES = 144, PER_LINE = 10;
+    struct line_t{
+        std::array<uint8_t,PER_LINE> sprites;   //  oam indices, by x with ties going to the lower entry.
+        uint8_t count{0};
+    };
+    //  called ahead of the write, while oam still holds the old value.
+    void on_oam_write(const uint8_t* oam, uint8_t offset, uint8_t val);
+    //  after all of oam changed at once, or the sprite height did.
+    void rebuild(const uint8_t* oam, size_t height);
+    const line_t& get(const uint8_t* oam, size_t ly){
+        if(dirty[ly])
+            build_line(oam, ly);
+        return lines[ly];
+    }
+protected:
+    //  sets or clears the sprite in the mask of every line its y covers, those lines need ordering again.
+    void mark(uint8_t sprite, uint8_t y, bool set);
+    void build_line(const uint8_t* oam, size_t ly);
+    std::array<uint64_t,LINES> masks{0};        //  bit n set when oam entry n covers the line.
+    std::array<line_t,LINES> lines;
+    std::array<bool,LINES> dirty{};
+    size_t height{8};
+};
\ No newline at end of file
@@ -0,0 +1,27 @@
+/*
+    the 384 tiles of vram decoded to one byte per pixel, decoded again only after a write to them.
+*/
+#pragma once
+#include<common_defs.h>
+#include<array>
+
+struct tile_cache_t{
+    static constexpr size_t TILE_COUNT = 384;
+    using tile_t = std::array<uint8_t,64>;  //  color indices, row by row.
+    //  vram is the 0x1800 bytes of tile data at 0x8000.
+    const tile_t& get(const uint8_t* vram, size_t tile){
+        if(dirty[tile])
+            decode(vram, tile);
+        return tiles[tile];
+    }
+    void invalidate(uint16_t adr){ dirty[(adr-0x8000)>>4] = true; }
+    void invalidate_all(){ dirty.fill(true); }
+protected:
+    void decode(const uint8_t* vram, size_t tile);
+    std::array<tile_t,TILE_COUNT> tiles;
+    std::array<bool,TILE_COUNT> dirty = [](){
+        std::array<bool,TILE_COUNT> dirty;
+        dirty.fill(true);
+        return dirty;
+    }();
+};
\ No newline at end of file
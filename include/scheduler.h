@@ -4,34 +4,52 @@
 #pragma once
 //  custom header
 #include<common_defs.h>
-#include<queue>
-#include<utility>
+#include<array>
 #include<functional>
+#include<limits>
 
 enum class scheduler_event{
-    IF_WRITE,
-    IE_WRITE,
-    EI,
-    DI,
-    TIMER 
+    TIMER,
+    PPU,
+    OAM_DMA,
+    COUNT
 };
 
 using timestamp_t = size_t;
-struct event_t{ std::function<void()> f; scheduler_event event; };
-
-struct event_pair_t: public std::pair<timestamp_t, event_t>{
-    using std::pair<timestamp_t, event_t>::pair;
-    bool operator<(const event_pair_t& arg) const{ return first < arg.first; }
-};
+static inline constexpr timestamp_t NO_EVENT = std::numeric_limits<timestamp_t>::max();
 
+//  one slot per event kind, arming a slot again moves its deadline instead of queueing a second event.
 struct scheduler_t{
-    bool is_event_pending();
+    static constexpr size_t EVENT_COUNT = (size_t)scheduler_event::COUNT;
+    bool is_event_pending(){ return cycles >= next_stamp; }
+    //  runs the handler of the earliest due event.
     void process_events();
-    void add_event(const timestamp_t& stamp, const event_t& event);
-    void tick_system(size_t t_cycles);
-    size_t get_cycles();
+    //  disarms the earliest due slot, returning false when nothing is due.
+    bool pop_due(scheduler_event& event);
+    //  arms the slot to fire delay t-cycles from now, replacing any deadline it already had.
+    void add_event(timestamp_t delay, scheduler_event event);
+    void reschedule(scheduler_event event, timestamp_t delay){ add_event(delay, event); }
+    void cancel(scheduler_event event);
+    bool is_scheduled(scheduler_event event){ return deadlines[(size_t)event] != NO_EVENT; }
+    timestamp_t get_deadline(scheduler_event event){ return deadlines[(size_t)event]; }
+    size_t get_pending_count();   //  armed slots, never more than EVENT_COUNT.
+    //  handlers are registered once, they run whenever their slot comes due.
+    void set_handler(scheduler_event event, std::function<void()> handler){ handlers[(size_t)event] = std::move(handler); }
+    void tick_system(size_t t_cycles){ cycles += t_cycles; }
+    //  skips idle time up to the next event, but no further than max_cycles.
+    void fast_forward(size_t max_cycles);
+    size_t get_cycles(){ return cycles; }
+    timestamp_t get_next_stamp(){ return next_stamp; }
 protected:
-    uint64_t cycles;
-    std::priority_queue<event_pair_t> events;
-};
-
+    void update_next_stamp();
+    uint64_t cycles{0};
+    //  cached earliest deadline, so polling it is a single compare.
+    timestamp_t next_stamp{NO_EVENT};
+    std::array<timestamp_t,EVENT_COUNT> deadlines = [](){
+        std::array<timestamp_t,EVENT_COUNT> deadlines;
+        deadlines.fill(NO_EVENT);
+        return deadlines;
+    }();
+    std::array<std::function<void()>,EVENT_COUNT> handlers;
+    friend struct jit_t;
+};
\ No newline at end of file
@@ -0,0 +1,32 @@
+/*
+    DIV/TIMA/TMA/TAC, derived from the cycle counter on access instead of ticked every cycle.
+*/
+#pragma once
+#include<common_defs.h>
+#include<scheduler_trait.h>
+
+struct gameboy_t;
+
+struct timer_unit_t: scheduler_component_trait<timer_unit_t>{
+    timer_unit_t(gameboy_t* gb): gb{gb} {}
+    //  handler of the TIMER event, reloads TIMA from TMA and requests the interrupt.
+    void update();
+    uint8_t read(uint16_t adr);
+    void write(uint16_t adr, uint8_t val);
+    //  the state the boot rom leaves behind.
+    void apply_post_boot_state();
+    gameboy_t* gb;
+protected:
+    uint16_t get_counter();                 //  the 16 bit system counter, DIV being its upper byte.
+    size_t get_period(){ return TAC_PERIODS[tac&0b11]; }
+    bool is_enabled(){ return tac&0b100; }
+    //  whether the counter bit TIMA counts the falling edges of is set, the input of the DIV and TAC glitches.
+    bool get_input(){ return is_enabled() && (get_counter()&(get_period()/2)); }
+    void sync();                            //  brings tima up to the current cycle.
+    void increment();
+    void schedule();                        //  arms the TIMER event at the next overflow.
+    static constexpr size_t TAC_PERIODS[4] = {1024, 16, 64, 256};
+    uint64_t counter_offset{0};             //  added to the cycle counter to get the system counter.
+    uint64_t tima_stamp{0};                 //  the cycle tima was last brought up to date.
+    uint8_t tima{0}, tma{0}, tac{0};
+};
\ No newline at end of file
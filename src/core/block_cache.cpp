@@ -0,0 +1,228 @@
+#include<core/block_cache.h>
+#include<disassemble/disassemble.h>
+
+basic_block_t* block_cache_t::find(uint16_t adr, size_t bank){
+    auto iter = blocks.find(key(adr, bank));
+    if(iter == blocks.end())
+        return nullptr;
+    return &iter->second;
+}
+
+basic_block_t* block_cache_t::build(memory_t& mem, uint16_t adr, size_t bank){
+    basic_block_t block;
+    block.start_adr = adr;
+    block.cycles = 0;
+    while(block.instrs.size() < MAX_BLOCK_LENGTH){
+        predecoded_instr_t instr;
+        cpu_function_entry entry;
+        instr.opcode = mem.debug_read(adr);
+        if(instr.opcode == 0xCB){
+            instr.operand = mem.debug_read(adr+1);
+            entry = instr_table::cb_range[instr.operand];
+            instr.length = 2;
+        } else{
+            entry = instr_table::noncb_range[instr.opcode];
+            instr.length = entry_get<CPU_ENTRY::BYTE_LENGTH>(entry);
+            switch(instr.length){
+            case 2:  instr.operand = mem.debug_read(adr+1);                                 break;
+            case 3:  instr.operand = mem.debug_read(adr+1) | (mem.debug_read(adr+2)<<8);    break;
+            default: instr.operand = 0;
+            }
+        }
+        //  every byte of the instruction has to come from the same cacheable region as the block.
+        uint16_t last_adr = adr+(instr.length ? instr.length-1 : 0);
+        if(region(adr) < 0 || region(adr) != region(block.start_adr) || region(last_adr) != region(adr) || last_adr < adr)
+            break;
+        instr.function = entry_get<CPU_ENTRY::FUNCTION>(entry);
+        instr.cycles = entry_get<CPU_ENTRY::CYCLES>(entry);
+        block.instrs.push_back(instr);
+        block.cycles += instr.cycles.first;
+        adr += instr.length;
+        if(ends_block(instr.opcode, instr.length))
+            break;
+    }
+    if(block.instrs.empty())
+        return nullptr;
+    block.end_adr = adr;
+    detect_idle(block);
+    if(fuse)
+        fuse_instrs(block);
+    if(block.start_adr >= 0x8000)
+        mark_code_lines(mem, block, key(block.start_adr, bank));
+    return &(blocks[key(block.start_adr, bank)] = std::move(block));
+}
+
+template<typename F>
+void block_cache_t::for_each_line(const basic_block_t& block, F f){
+    for(size_t line = block.start_adr>>4; line <= (size_t)(block.end_adr-1)>>4; ++line){
+        f(line);
+        //  work ram is also written through its echo.
+        switch(line<<4){
+        case 0xC000 ... 0xDDFF: f(line+0x200); break;
+        case 0xE000 ... 0xFDFF: f(line-0x200); break;
+        }
+    }
+}
+
+void block_cache_t::mark_code_lines(memory_t& mem, const basic_block_t& block, uint32_t key){
+    for_each_line(block, [&](uint16_t line){
+        code_lines[line>>4] |= 1<<(line&0x0F);
+        line_blocks[line].push_back(key);
+        mem.unmap_write_page(line<<4);
+    });
+}
+
+void block_cache_t::erase(memory_t& mem, uint32_t key){
+    auto iter = blocks.find(key);
+    if(iter == blocks.end())
+        return;
+    for_each_line(iter->second, [&](uint16_t line){
+        auto keys = line_blocks.find(line);
+        if(keys == line_blocks.end())
+            return;
+        std::erase(keys->second, key);
+        if(!keys->second.empty())
+            return;
+        line_blocks.erase(keys);
+        if(!(code_lines[line>>4] &= ~(1<<(line&0x0F))))
+            mem.remap_write_page(line<<4);
+    });
+    blocks.erase(iter);
+}
+
+void block_cache_t::invalidate(memory_t& mem, uint16_t first, uint16_t last){
+    bool dropped = false;
+    for(size_t line = first>>4; line <= (size_t)last>>4; ++line){
+        if(!(code_lines[line>>4]>>(line&0x0F)&1))
+            continue;
+        //  erase edits the list, so it walks a copy.
+        const std::vector<uint32_t> keys = line_blocks[line];
+        for(uint32_t key: keys)
+            erase(mem, key);
+        dropped = true;
+    }
+    if(dropped)
+        ++generation;
+}
+
+int block_cache_t::region(uint16_t adr){
+    switch(adr){
+    case 0x0000 ... 0x3FFF: return 0;
+    case 0x4000 ... 0x7FFF: return 1;
+    case 0x8000 ... 0xFDFF: return 2;
+    case 0xFF80 ... 0xFFFE: return 3;
+    }
+    //  oam, io and the interrupt enable register are never cached.
+    return -1;
+}
+
+bool block_cache_t::ends_block(uint8_t opc, size_t length){
+    switch(opc){
+    case 0x10:  //  STOP
+    case 0x76:  //  HALT
+    case 0xF3:  //  DI
+    case 0xFB:  //  EI
+        return true;
+    }
+    //  invalid instructions have a length of 0 and throw once they're executed.
+    return length == 0 || disassembler_t::is_noncb_branch(opc);
+}
+
+void block_cache_t::detect_idle(basic_block_t& block){
+    //  only A and F may be written, and only by loads or idempotent operations (cp, and, or, bit),
+    //  so an iteration that starts and ends with the same A and F repeats forever until an event.
+    bool reads_hl = false;
+    for(size_t i = 0; i+1 < block.instrs.size(); ++i){
+        const auto& instr = block.instrs[i];
+        switch(instr.opcode){
+        case 0x00:                                      //  NOP
+        case 0xB8 ... 0xBD: case 0xBF: case 0xFE:       //  CP
+        case 0xA0 ... 0xA5: case 0xA7: case 0xE6:       //  AND
+        case 0xB0 ... 0xB5: case 0xB7: case 0xF6:       //  OR
+            break;
+        case 0xFA:                                      //  LD A,(n16)
+            if(memory_t::is_time_dependent(instr.operand))
+                return;
+            break;
+        case 0xF0:                                      //  LDH A,(n8)
+            if(memory_t::is_time_dependent(0xFF00|instr.operand))
+                return;
+            break;
+        case 0x7E: case 0xBE: case 0xA6: case 0xB6:     //  LD/CP/AND/OR with (HL)
+            reads_hl = true;
+            break;
+        case 0xCB:                                      //  BIT
+            if(instr.operand < 0x40 || instr.operand > 0x7F)
+                return;
+            reads_hl |= (instr.operand&0x07) == 6;
+            break;
+        default:
+            return;
+        }
+    }
+    const auto& last = block.instrs.back();
+    uint16_t target;
+    switch(last.opcode){
+    case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:  //  JR
+        target = block.end_adr+(int8_t)last.operand;
+        break;
+    case 0xC3: case 0xC2: case 0xCA: case 0xD2: case 0xDA:  //  JP
+        target = last.operand;
+        break;
+    default:
+        return;
+    }
+    block.idle = target == block.start_adr;
+    block.idle_reads_hl = reads_hl;
+}
+
+void block_cache_t::fuse_instrs(basic_block_t& block){
+    std::vector<predecoded_instr_t> fused;
+    fused.reserve(block.instrs.size());
+    for(size_t i = 0; i < block.instrs.size();){
+        const fused_entry_t* match = nullptr;
+        for(const auto& entry: instr_table::fused_range){
+            if(i+entry.count > block.instrs.size())
+                continue;
+            size_t n = 0;
+            while(n < entry.count && block.instrs[i+n].opcode == entry.opcodes[n])
+                ++n;
+            if(n == entry.count){
+                match = &entry;
+                break;
+            }
+        }
+        if(!match){
+            fused.push_back(block.instrs[i++]);
+            continue;
+        }
+        //  the immediates of every part are packed in order.
+        predecoded_instr_t instr = block.instrs[i];
+        uint16_t operand = 0;
+        size_t shift = 0;
+        for(size_t n = 0; n < match->count; ++n){
+            const auto& part = block.instrs[i+n];
+            operand |= part.operand<<shift;
+            shift += (part.length-1)*8;
+        }
+        instr.function = entry_get<CPU_ENTRY::FUNCTION>(match->entry);
+        instr.cycles = entry_get<CPU_ENTRY::CYCLES>(match->entry);
+        instr.length = entry_get<CPU_ENTRY::BYTE_LENGTH>(match->entry);
+        instr.operand = operand;
+        fused.push_back(instr);
+        i += match->count;
+    }
+    block.instrs = std::move(fused);
+}
+
+void block_cache_t::clear(){
+    blocks.clear();
+    code_lines.fill(0);
+    line_blocks.clear();
+    ++generation;
+}
+
+void block_cache_t::drop_native(){
+    for(auto& entry: blocks)
+        entry.second.native = nullptr;
+}
\ No newline at end of file
@@ -75,7 +75,7 @@ consteval auto _get_switch_2(size_t func){
 }
 
 
-const _instr_array instr_table::noncb_range = []() consteval{
+constexpr _instr_array instr_table::noncb_range = []() consteval{
     _instr_array array;
     std::fill(array.begin(),array.end(),_gen<0,0,0,invalid_instr>());
     //  define some functions with no discernable pattern.
@@ -259,7 +259,7 @@ consteval void fill_first_quarter(_instr_array& arg){
         fill_first_quarter<iter+1>(arg);   
 }
 
-const _instr_array instr_table::cb_range = []() consteval{
+constexpr _instr_array instr_table::cb_range = []() consteval{
     _instr_array array;
     fill_first_quarter(array);
     fill_cb_table_bit(array);
@@ -267,3 +267,155 @@ const _instr_array instr_table::cb_range = []() consteval{
     fill_cb_table_set(array);
     return array;
 }();
+
+
+consteval _threaded_array _gen_threaded(const _instr_array& range, uint16_t label_base){
+    _threaded_array array;
+    for(size_t i = 0; i < INSTR_ARRAY_SIZE; ++i){
+        const auto& [bytes, cycles, f] = range[i];
+        array[i] = { 
+            f == invalid_instr ? THREADED_INVALID : (uint16_t)(label_base+i),
+            (uint8_t)bytes,(uint8_t)cycles.first,(uint8_t)cycles.second };
+    }
+    return array;
+}
+
+//  the loop advanced pc past the whole run, each part then sees its own pc and immediates.
+template<uint8_t... opcodes>
+struct fused_instr_t{
+    static void run(cfa arg){
+        constexpr size_t bytes = (std::get<0>(instr_table::noncb_range[opcodes]) + ...);
+        arg.gb.regs.get<RI::PC>() -= bytes;
+        run_part<opcodes...>(arg, arg.operand, arg.gb.blocks.get_generation(), 0);
+    }
+private:
+    template<uint8_t opc, uint8_t... rest>
+    __always_inline static void run_part(cfa arg, uint16_t imm, size_t generation, _instr_ticks ticks){
+        constexpr auto entry = instr_table::noncb_range[opc];
+        constexpr size_t length = std::get<0>(entry);
+        auto& gb = arg.gb;
+        gb.regs.get<RI::PC>() += length;
+        arg.operand = length == 3 ? imm : (uint8_t)imm;
+        std::get<2>(entry)(arg);
+        if constexpr(sizeof...(rest) > 0){
+            //  stop where the interpreter would look at events, interrupts, halt, a write to code, oam dma or a breakpoint.
+            ticks += std::get<1>(entry).first;
+            if(gb.scheduler.get_cycles()+ticks >= gb.scheduler.get_next_stamp() || gb.interrupt_check || gb.halted
+                || generation != gb.blocks.get_generation() || gb.mem.is_oam_dma_active() || gb.dbg_paused){
+                gb.scheduler.tick_system(ticks);
+                arg.did_split = true;
+                return;
+            }
+            run_part<rest...>(arg, length == 2 ? imm>>8 : imm, generation, ticks);
+        }
+    }
+};
+
+template<uint8_t... opcodes>
+consteval fused_entry_t _gen_fused(){
+    constexpr std::array<uint8_t,sizeof...(opcodes)> ops{opcodes...};
+    constexpr auto last = std::get<1>(instr_table::noncb_range[ops.back()]);
+    constexpr size_t bytes = (std::get<0>(instr_table::noncb_range[opcodes]) + ...);
+    constexpr _instr_ticks ticks = (std::get<1>(instr_table::noncb_range[opcodes]).first + ...)-last.first;
+    constexpr _instr_br_ticks br_ticks = (std::get<1>(instr_table::noncb_range[opcodes]).second + ...)-last.second;
+    static_assert(ops.size() <= 4, "too many fused instructions");
+    static_assert(ticks == br_ticks, "only the last fused instruction may branch");
+    static_assert(bytes-ops.size() <= 2, "fused instructions can't carry more than 2 immediate bytes");
+    return { {opcodes...}, ops.size(), 
+        cpu_function_entry{bytes,{ticks+last.first,ticks+last.second},fused_instr_t<opcodes...>::run} };
+}
+
+constexpr _fused_array instr_table::fused_range = {
+    _gen_fused<0x0B,0x78,0xB1,0x20>(),  //  dec bc; ld a,b; or c; jr nz
+    _gen_fused<0x2A,0x12,0x13>(),       //  ld a,(hl+); ld (de),a; inc de
+    _gen_fused<0x78,0xB1,0x20>(),       //  ld a,b; or c; jr nz
+    _gen_fused<0x2A,0x12>(),            //  ld a,(hl+); ld (de),a
+    _gen_fused<0x12,0x13>(),            //  ld (de),a; inc de
+    //  dec r8; jr nz
+    _gen_fused<0x05,0x20>(), _gen_fused<0x0D,0x20>(), _gen_fused<0x15,0x20>(), _gen_fused<0x1D,0x20>(),
+    _gen_fused<0x25,0x20>(), _gen_fused<0x2D,0x20>(), _gen_fused<0x3D,0x20>(),
+    //  cp n8; jr cc
+    _gen_fused<0xFE,0x20>(), _gen_fused<0xFE,0x28>(), _gen_fused<0xFE,0x30>(), _gen_fused<0xFE,0x38>()
+};
+
+constexpr _threaded_array instr_table::threaded_noncb_range = _gen_threaded(instr_table::noncb_range, 0x000);
+constexpr _threaded_array instr_table::threaded_cb_range = _gen_threaded(instr_table::cb_range, 0x100);
+
+#define _REPEAT_ROW(m,h)                                                    \
+    m(h##0) m(h##1) m(h##2) m(h##3) m(h##4) m(h##5) m(h##6) m(h##7)         \
+    m(h##8) m(h##9) m(h##A) m(h##B) m(h##C) m(h##D) m(h##E) m(h##F)
+#define _REPEAT_256(m)                                                      \
+    _REPEAT_ROW(m,0x0) _REPEAT_ROW(m,0x1) _REPEAT_ROW(m,0x2) _REPEAT_ROW(m,0x3) \
+    _REPEAT_ROW(m,0x4) _REPEAT_ROW(m,0x5) _REPEAT_ROW(m,0x6) _REPEAT_ROW(m,0x7) \
+    _REPEAT_ROW(m,0x8) _REPEAT_ROW(m,0x9) _REPEAT_ROW(m,0xA) _REPEAT_ROW(m,0xB) \
+    _REPEAT_ROW(m,0xC) _REPEAT_ROW(m,0xD) _REPEAT_ROW(m,0xE) _REPEAT_ROW(m,0xF)
+
+#define _NONCB_LABEL(n) &&noncb_##n,
+#define _CB_LABEL(n)    &&cb_##n,
+//  fetches and decodes the instruction at pc, then jumps to its handler.
+#define _THREADED_DISPATCH()                                                \
+    prev_pc = pc;                                                           \
+    opcode = gb.mem.template read<policy>(pc);                              \
+    if(opcode == 0xCB){                                                     \
+        arg.operand = gb.mem.read_operand(pc+1, 1);                         \
+        entry = threaded_cb_range[arg.operand];                             \
+    } else{                                                                 \
+        entry = threaded_noncb_range[opcode];                               \
+        if(entry.bytes > 1)                                                 \
+            arg.operand = gb.mem.read_operand(pc+1, entry.bytes-1);         \
+    }                                                                       \
+    pc += entry.bytes;                                                      \
+    arg.did_branch = false;                                                 \
+    goto *labels[entry.label];
+//  every handler retires its own instruction and dispatches the next one itself,
+//  so each has its own indirect jump for the branch predictor to learn.
+#define _THREADED_NEXT()                                                    \
+    gb.scheduler.tick_system(arg.did_branch ? entry.br_ticks : entry.ticks);\
+    if(gb.profiling)                                                        \
+        gb.profiler.record(prev_pc, opcode, arg.operand,                    \
+            arg.did_branch ? entry.br_ticks : entry.ticks);                 \
+    if constexpr(policy == debug_policy::INSTRUMENTED){                     \
+        gb.dbg_instruction_hook(prev_pc, opcode, entry.bytes, arg.operand,  \
+            arg.did_branch);                                                \
+        if(gb.dbg_paused)                                                   \
+            return true;                                                    \
+    }                                                                       \
+    if(gb.halted || gb.interrupt_check || gb.scheduler.is_event_pending()   \
+        || gb.scheduler.get_cycles() >= deadline)                           \
+        return true;                                                        \
+    _THREADED_DISPATCH()
+#define _NONCB_HANDLER(n)                                                   \
+    noncb_##n:                                                              \
+    if constexpr(std::get<2>(noncb_range[n]) != invalid_instr)              \
+        std::get<2>(noncb_range[n])(arg);                                   \
+    _THREADED_NEXT()
+#define _CB_HANDLER(n)                                                      \
+    cb_##n:                                                                 \
+    if constexpr(std::get<2>(cb_range[n]) != invalid_instr)                 \
+        std::get<2>(cb_range[n])(arg);                                      \
+    _THREADED_NEXT()
+
+template<debug_policy policy>
+bool instr_table::run_threaded(gameboy_t& gb, size_t budget){
+    static void* const labels[THREADED_INVALID+1] = {
+        _REPEAT_256(_NONCB_LABEL)
+        _REPEAT_256(_CB_LABEL)
+        &&invalid
+    };
+    auto& pc = gb.regs.get<RI::PC>();
+    const size_t deadline = gb.scheduler.get_cycles()+budget;
+    cpu_function_argument_t arg{gb};
+    threaded_entry_t entry;
+    uint16_t prev_pc;
+    uint8_t opcode;
+    _THREADED_DISPATCH()
+    _REPEAT_256(_NONCB_HANDLER)
+    _REPEAT_256(_CB_HANDLER)
+invalid:
+    //  left untouched for the caller, so it's reported like on every other core.
+    pc = prev_pc;
+    return false;
+}
+
+template bool instr_table::run_threaded<debug_policy::FAST>(gameboy_t& gb, size_t budget);
+template bool instr_table::run_threaded<debug_policy::INSTRUMENTED>(gameboy_t& gb, size_t budget);
\ No newline at end of file
@@ -0,0 +1,441 @@
+#include<core/jit.h>
+#include<gameboy.h>
+#if defined(__x86_64__)
+#include<sys/mman.h>
+#endif
+#include<cstring>
+#include<array>
+
+void x64_emitter_t::mov_r64_imm64(REG r, uint64_t v){
+    bytes({(uint8_t)(0x48|(r>>3)), (uint8_t)(0xB8|(r&7))});
+    imm64(v);
+}
+
+void x64_emitter_t::mov_bank_imm8(int32_t disp, uint8_t v){
+    bytes({0x41,0xC6,0x84,0x24}); imm32(disp); bytes({v});
+}
+
+void x64_emitter_t::mov_bank_imm16(int32_t disp, uint16_t v){
+    bytes({0x66,0x41,0xC7,0x84,0x24}); imm32(disp); imm16(v);
+}
+
+void x64_emitter_t::mov_al_bank(int32_t disp){
+    bytes({0x41,0x8A,0x84,0x24}); imm32(disp);
+}
+
+void x64_emitter_t::mov_bank_al(int32_t disp){
+    bytes({0x41,0x88,0x84,0x24}); imm32(disp);
+}
+
+void x64_emitter_t::mov_ax_bank(int32_t disp){
+    bytes({0x66,0x41,0x8B,0x84,0x24}); imm32(disp);
+}
+
+void x64_emitter_t::mov_bank_ax(int32_t disp){
+    bytes({0x66,0x41,0x89,0x84,0x24}); imm32(disp);
+}
+
+void x64_emitter_t::inc_bank16(int32_t disp){
+    bytes({0x66,0x41,0xFF,0x84,0x24}); imm32(disp);
+}
+
+void x64_emitter_t::dec_bank16(int32_t disp){
+    bytes({0x66,0x41,0xFF,0x8C,0x24}); imm32(disp);
+}
+
+void x64_emitter_t::mov_cl_bank(int32_t disp){
+    bytes({0x41,0x8A,0x8C,0x24}); imm32(disp);
+}
+
+void x64_emitter_t::mov_bank_cl(int32_t disp){
+    bytes({0x41,0x88,0x8C,0x24}); imm32(disp);
+}
+
+void x64_emitter_t::movzx_edx_bank16(int32_t disp){
+    bytes({0x41,0x0F,0xB7,0x94,0x24}); imm32(disp);
+}
+
+void x64_emitter_t::alu_al_bank(ALU op, int32_t disp){
+    bytes({0x41,(uint8_t)(op|0x02),0x84,0x24}); imm32(disp);
+}
+
+void x64_emitter_t::alu_al_imm8(ALU op, uint8_t v){
+    bytes({(uint8_t)(op|0x04),v});
+}
+
+void x64_emitter_t::cmp_bank_imm8(int32_t disp, uint8_t v){
+    bytes({0x41,0x80,0xBC,0x24}); imm32(disp); bytes({v});
+}
+
+void x64_emitter_t::test_bank_imm8(int32_t disp, uint8_t v){
+    bytes({0x41,0xF6,0x84,0x24}); imm32(disp); bytes({v});
+}
+
+void x64_emitter_t::mov_arg_imm8(int32_t disp, uint8_t v){
+    bytes({0xC6,0x83}); imm32(disp); bytes({v});
+}
+
+void x64_emitter_t::mov_arg_imm16(int32_t disp, uint16_t v){
+    bytes({0x66,0xC7,0x83}); imm32(disp); imm16(v);
+}
+
+void x64_emitter_t::cmp_arg_imm8(int32_t disp, uint8_t v){
+    bytes({0x80,0xBB}); imm32(disp); bytes({v});
+}
+
+void x64_emitter_t::add_cycles_imm32(uint32_t v){
+    bytes({0x49,0x81,0x45,0x00}); imm32(v);
+}
+
+void x64_emitter_t::add_cycles_rax(){
+    bytes({0x49,0x01,0x45,0x00});
+}
+
+void x64_emitter_t::mov_rax_cycles(){
+    bytes({0x49,0x8B,0x45,0x00});
+}
+
+size_t x64_emitter_t::jcc_rel32(uint8_t cc){
+    bytes({0x0F,(uint8_t)(0x80|cc)}); imm32(0);
+    return code.size()-4;
+}
+
+size_t x64_emitter_t::jmp_rel32(){
+    bytes({0xE9}); imm32(0);
+    return code.size()-4;
+}
+
+void x64_emitter_t::patch_rel32(size_t at, size_t target){
+    int32_t rel = target-(at+4);
+    std::memcpy(&code[at], &rel, 4);
+}
+
+void jit_t::code_buffer_deleter::operator()(uint8_t* p) const{
+#if defined(__x86_64__)
+    munmap(p, CODE_BUFFER_SIZE);
+#endif
+}
+
+bool jit_t::is_supported(){
+#if defined(__x86_64__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+//  offsets of the 8 bit registers in opcode encoding order (b,c,d,e,h,l,(hl),a).
+static int32_t r8_offset(gameboy_t& gb, uint8_t r){
+    auto base = reinterpret_cast<uint8_t*>(&gb.regs);
+    switch(r){
+    case 0: return reinterpret_cast<uint8_t*>(&gb.regs.get<RI::B>())-base;
+    case 1: return reinterpret_cast<uint8_t*>(&gb.regs.get<RI::C>())-base;
+    case 2: return reinterpret_cast<uint8_t*>(&gb.regs.get<RI::D>())-base;
+    case 3: return reinterpret_cast<uint8_t*>(&gb.regs.get<RI::E>())-base;
+    case 4: return reinterpret_cast<uint8_t*>(&gb.regs.get<RI::H>())-base;
+    case 5: return reinterpret_cast<uint8_t*>(&gb.regs.get<RI::L>())-base;
+    }
+    return reinterpret_cast<uint8_t*>(&gb.regs.get<RI::A>())-base;
+}
+
+//  offsets of bc, de, hl, sp and pc in opcode encoding order, pc being appended.
+static int32_t r16_offset(gameboy_t& gb, uint8_t r){
+    auto base = reinterpret_cast<uint8_t*>(&gb.regs);
+    switch(r){
+    case 0: return reinterpret_cast<uint8_t*>(&gb.regs.get<RI::BC>())-base;
+    case 1: return reinterpret_cast<uint8_t*>(&gb.regs.get<RI::DE>())-base;
+    case 2: return reinterpret_cast<uint8_t*>(&gb.regs.get<RI::HL>())-base;
+    case 3: return reinterpret_cast<uint8_t*>(&gb.regs.get<RI::SP>())-base;
+    }
+    return reinterpret_cast<uint8_t*>(&gb.regs.get<RI::PC>())-base;
+}
+
+int32_t jit_t::f_offset(gameboy_t& gb){
+    return reinterpret_cast<uint8_t*>(&gb.regs.af._narrow._l)-reinterpret_cast<uint8_t*>(&gb.regs);
+}
+
+int32_t jit_t::lazy_op_offset(gameboy_t& gb){
+    return reinterpret_cast<uint8_t*>(&gb.regs.lazy.op)-reinterpret_cast<uint8_t*>(&gb.regs);
+}
+
+//  the Z, H and C flags of F from the SF ZF 0 AF 0 PF 1 CF layout lahf leaves in ah.
+static constexpr std::array<uint8_t,256> lahf_to_f = [](){
+    std::array<uint8_t,256> table{};
+    for(size_t ah = 0; ah < table.size(); ++ah)
+        table[ah] = (ah&0x40 ? 0x80 : 0)|(ah&0x10 ? 0x20 : 0)|(ah&0x01 ? 0x10 : 0);
+    return table;
+}();
+
+static void materialize_flags(cpu_register_bank_t* regs){
+    regs->materialize_flags();
+}
+
+bool jit_t::is_native(const predecoded_instr_t& instr){
+    const uint8_t opc = instr.opcode;
+    switch(opc){
+    case 0x00:                                          //  NOP
+    case 0x01: case 0x11: case 0x21: case 0x31:         //  LD r16,n16
+    case 0x03: case 0x13: case 0x23: case 0x33:         //  INC r16
+    case 0x0B: case 0x1B: case 0x2B: case 0x3B:         //  DEC r16
+    case 0x06: case 0x0E: case 0x16: case 0x1E: case 0x26: case 0x2E: case 0x3E:   //  LD r8,n8
+    case 0x18:                                          //  JR e8
+    case 0xC3:                                          //  JP n16
+    case 0xF9:                                          //  LD SP,HL
+        return true;
+    case 0x40 ... 0x7F:                                 //  LD r8,r8
+        return (opc&0x07) != 6 && (opc&0x38) != 0x30;
+    case 0x80 ... 0x87: case 0x90 ... 0x97:             //  ADD, SUB, AND, XOR, OR and CP with r8
+    case 0xA0 ... 0xBF:
+        return (opc&0x07) != 6;
+    case 0xC6: case 0xD6: case 0xE6: case 0xEE: case 0xF6: case 0xFE:   //  the same with n8
+        return true;
+    }
+    return false;
+}
+
+bool jit_t::is_memory(const predecoded_instr_t& instr){
+    const uint8_t opc = instr.opcode;
+    switch(opc){
+    case 0x02: case 0x12: case 0x22: case 0x32:         //  LD (r16),A
+    case 0x0A: case 0x1A: case 0x2A: case 0x3A:         //  LD A,(r16)
+    case 0x36:                                          //  LD (HL),n8
+    case 0xEA: case 0xFA:                               //  LD (n16),A and LD A,(n16)
+        return true;
+    case 0x40 ... 0x7F:                                 //  LD r8,(HL) and LD (HL),r8
+        return opc != 0x76 && ((opc&0x07) == 6 || (opc&0x38) == 0x30);
+    }
+    return false;
+}
+
+bool jit_t::is_conditional_branch(const predecoded_instr_t& instr){
+    switch(instr.opcode){
+    case 0x20: case 0x28: case 0x30: case 0x38:         //  JR cc,e8
+    case 0xC2: case 0xCA: case 0xD2: case 0xDA:         //  JP cc,n16
+        return true;
+    }
+    return false;
+}
+
+void jit_t::emit_native(gameboy_t& gb, x64_emitter_t& e, const predecoded_instr_t& instr, uint16_t next_pc){
+    const uint8_t opc = instr.opcode;
+    switch(opc){
+    case 0x00:
+        break;
+    case 0x01: case 0x11: case 0x21: case 0x31:
+        e.mov_bank_imm16(r16_offset(gb, opc>>4), instr.operand);
+        break;
+    case 0x03: case 0x13: case 0x23: case 0x33:
+        e.inc_bank16(r16_offset(gb, opc>>4));
+        break;
+    case 0x0B: case 0x1B: case 0x2B: case 0x3B:
+        e.dec_bank16(r16_offset(gb, opc>>4));
+        break;
+    case 0x18:
+        e.mov_bank_imm16(r16_offset(gb, 4), next_pc+(int8_t)instr.operand);
+        break;
+    case 0xC3:
+        e.mov_bank_imm16(r16_offset(gb, 4), instr.operand);
+        break;
+    case 0xF9:
+        e.mov_ax_bank(r16_offset(gb, 2));
+        e.mov_bank_ax(r16_offset(gb, 3));
+        break;
+    case 0x40 ... 0x7F:
+        e.mov_al_bank(r8_offset(gb, opc&0x07));
+        e.mov_bank_al(r8_offset(gb, (opc>>3)&0x07));
+        break;
+    case 0x80 ... 0xBF:
+    case 0xC6: case 0xD6: case 0xE6: case 0xEE: case 0xF6: case 0xFE:
+        emit_alu(gb, e, instr);
+        break;
+    default:    //  LD r8,n8
+        e.mov_bank_imm8(r8_offset(gb, (opc>>3)&0x07), instr.operand);
+    }
+}
+
+void jit_t::emit_alu(gameboy_t& gb, x64_emitter_t& e, const predecoded_instr_t& instr){
+    using ALU = x64_emitter_t::ALU;
+    const uint8_t opc = instr.opcode;
+    //  the register and immediate forms share bits 3 to 5: add, adc, sub, sbc, and, xor, or, cp.
+    const uint8_t kind = (opc>>3)&0x07;
+    static constexpr std::array<ALU,8> ops{ALU::ADD, ALU::ADD, ALU::SUB, ALU::SUB, ALU::AND, ALU::XOR, ALU::OR, ALU::CMP};
+    //  the bits of the table to keep and the ones to set, N for subtractions and H for and.
+    static constexpr std::array<uint8_t,8> keep{0xB0, 0xB0, 0xB0, 0xB0, 0x80, 0x80, 0x80, 0xB0};
+    static constexpr std::array<uint8_t,8> set{0x00, 0x00, 0x40, 0x40, 0x20, 0x00, 0x00, 0x40};
+    const int32_t a = r8_offset(gb, 7);
+    e.mov_al_bank(a);
+    if(opc >= 0xC0)
+        e.alu_al_imm8(ops[kind], instr.operand);
+    else
+        e.alu_al_bank(ops[kind], r8_offset(gb, opc&0x07));
+    e.bytes({0x9F});                                            //  lahf
+    if(ops[kind] != ALU::CMP)
+        e.mov_bank_al(a);
+    e.bytes({0x0F,0xB6,0xCC});                                  //  movzx ecx, ah
+    e.mov_r64_imm64(x64_emitter_t::RDX, reinterpret_cast<uint64_t>(lahf_to_f.data()));
+    e.bytes({0x8A,0x0C,0x0A});                                  //  mov cl, [rdx+rcx]
+    e.bytes({0x80,0xE1,keep[kind]});                            //  and cl, keep
+    if(set[kind])
+        e.bytes({0x80,0xC9,set[kind]});                         //  or cl, set
+    //  every flag was written, whatever operation was still pending is stale.
+    e.mov_bank_cl(f_offset(gb));
+    e.mov_bank_imm8(lazy_op_offset(gb), (uint8_t)FLAG_OP::NONE);
+}
+
+void jit_t::emit_memory(gameboy_t& gb, x64_emitter_t& e, const predecoded_instr_t& instr){
+    const uint8_t opc = instr.opcode;
+    const bool store = opc == 0x36 || opc == 0xEA || (opc < 0x40 && !(opc&0x08)) || (opc&0xF8) == 0x70;
+    //  edx = address.
+    switch(opc){
+    case 0x02: case 0x0A: e.movzx_edx_bank16(r16_offset(gb, 0));             break;
+    case 0x12: case 0x1A: e.movzx_edx_bank16(r16_offset(gb, 1));             break;
+    case 0xEA: case 0xFA: e.bytes({0xBA}); e.imm32(instr.operand);          break;  //  mov edx, imm32
+    default:              e.movzx_edx_bank16(r16_offset(gb, 2));
+    }
+    //  rax = the page, the same lookup memory_t does before its slow path.
+    e.bytes({0x89,0xD1});                                       //  mov ecx, edx
+    e.bytes({0xC1,0xE9,0x08});                                  //  shr ecx, 8
+    e.mov_r64_imm64(x64_emitter_t::RAX, store ? reinterpret_cast<uint64_t>(gb.mem.write_pages.data())
+                                              : reinterpret_cast<uint64_t>(gb.mem.read_pages.data()));
+    e.bytes({0x48,0x8B,0x04,0xC8});                             //  mov rax, [rax+rcx*8]
+    e.bytes({0x48,0x85,0xC0});                                  //  test rax, rax
+    const size_t slow = e.jcc_rel32(0x4);                       //  jz
+    e.bytes({0x0F,0xB6,0xD2});                                  //  movzx edx, dl
+    if(opc == 0x36)
+        e.bytes({0xC6,0x04,0x10,(uint8_t)instr.operand});       //  mov byte [rax+rdx], imm8
+    else if(store){
+        e.mov_cl_bank(r8_offset(gb, (opc&0xF8) == 0x70 ? opc&0x07 : 7));
+        e.bytes({0x88,0x0C,0x10});                              //  mov [rax+rdx], cl
+    } else{
+        e.bytes({0x8A,0x0C,0x10});                              //  mov cl, [rax+rdx]
+        e.mov_bank_cl(r8_offset(gb, opc >= 0x40 && opc < 0xC0 ? (opc>>3)&0x07 : 7));
+    }
+    switch(opc){
+    case 0x22: case 0x2A: e.inc_bank16(r16_offset(gb, 2)); break;
+    case 0x32: case 0x3A: e.dec_bank16(r16_offset(gb, 2)); break;
+    }
+    const size_t done = e.jmp_rel32();
+    e.patch_rel32(slow, e.code.size());
+    emit_call(gb, e, instr);
+    e.patch_rel32(done, e.code.size());
+}
+
+void jit_t::emit_branch(gameboy_t& gb, x64_emitter_t& e, const predecoded_instr_t& instr, uint16_t next_pc){
+    const uint8_t opc = instr.opcode;
+    //  F only holds the flags once the pending operation is written back.
+    e.cmp_bank_imm8(lazy_op_offset(gb), (uint8_t)FLAG_OP::NONE);
+    e.bytes({0x74,0x0F});                                       //  je over the call
+    e.bytes({0x4C,0x89,0xE7});                                  //  mov rdi, r12
+    e.mov_r64_imm64(x64_emitter_t::RAX, reinterpret_cast<uint64_t>(&materialize_flags));
+    e.bytes({0xFF,0xD0});                                       //  call rax
+    //  bit 4 picks between Z and C, bit 3 between the flag being unset or set.
+    e.test_bank_imm8(f_offset(gb), opc&0x10 ? 0x10 : 0x80);
+    const size_t not_taken = e.jcc_rel32(opc&0x08 ? 0x4 : 0x5); //  je when it needs the flag set, jne otherwise
+    e.mov_bank_imm16(r16_offset(gb, 4), opc < 0xC0 ? next_pc+(int8_t)instr.operand : instr.operand);
+    e.add_cycles_imm32(instr.cycles.second);
+    const size_t done = e.jmp_rel32();
+    e.patch_rel32(not_taken, e.code.size());
+    e.add_cycles_imm32(instr.cycles.first);
+    e.patch_rel32(done, e.code.size());
+}
+
+void jit_t::emit_call(gameboy_t& gb, x64_emitter_t& e, const predecoded_instr_t& instr){
+    cpu_function_argument_t probe{gb};
+    e.mov_arg_imm16(reinterpret_cast<uint8_t*>(&probe.operand)-reinterpret_cast<uint8_t*>(&probe), instr.operand);
+    e.bytes({0x48,0x89,0xDF});                                  //  mov rdi, rbx
+    e.mov_r64_imm64(x64_emitter_t::RAX, reinterpret_cast<uint64_t>(instr.function));
+    e.bytes({0xFF,0xD0});                                       //  call rax
+}
+
+bool jit_t::compile(gameboy_t& gb, basic_block_t& block){
+#if defined(__x86_64__)
+    if(failed || block.start_adr >= 0x8000)
+        return false;
+    for(const auto& instr: block.instrs){
+        if(!instr.length)   //  invalid instructions throw, which can't unwind through translated code.
+            return false;
+    }
+    if(!buffer){
+        void* p = mmap(nullptr, CODE_BUFFER_SIZE, PROT_READ|PROT_WRITE|PROT_EXEC, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if(p == MAP_FAILED){
+            failed = true;
+            return false;
+        }
+        buffer.reset(static_cast<uint8_t*>(p));
+    }
+    cpu_function_argument_t probe{gb};
+    const int32_t did_branch_off = reinterpret_cast<uint8_t*>(&probe.did_branch)-reinterpret_cast<uint8_t*>(&probe);
+    const int32_t pc_off = r16_offset(gb, 4);
+    x64_emitter_t e;
+    std::vector<size_t> exits;
+    //  prologue: rbx = argument, r12 = register bank, r13 = cycle counter.
+    e.bytes({0x53, 0x41,0x54, 0x41,0x55});                      //  push rbx; push r12; push r13
+    e.bytes({0x48,0x89,0xFB});                                  //  mov rbx, rdi
+    e.mov_r64_imm64(x64_emitter_t::R12, reinterpret_cast<uint64_t>(&gb.regs));
+    e.mov_r64_imm64(x64_emitter_t::R13, reinterpret_cast<uint64_t>(&gb.scheduler.cycles));
+    uint16_t pc = block.start_adr;
+    for(size_t i = 0; i < block.instrs.size(); ++i){
+        const auto& instr = block.instrs[i];
+        const bool last = i+1 == block.instrs.size();
+        const bool native = is_native(instr);
+        pc += instr.length;
+        e.mov_bank_imm16(pc_off, pc);
+        if(is_conditional_branch(instr))
+            emit_branch(gb, e, instr, pc);
+        else if(native){
+            emit_native(gb, e, instr, pc);
+            e.add_cycles_imm32(instr.opcode == 0x18 || instr.opcode == 0xC3 ? instr.cycles.second : instr.cycles.first);
+        } else if(is_memory(instr)){
+            emit_memory(gb, e, instr);
+            e.add_cycles_imm32(instr.cycles.first);
+        } else{
+            emit_call(gb, e, instr);
+            if(instr.cycles.first != instr.cycles.second){
+                e.cmp_arg_imm8(did_branch_off, 0);
+                e.bytes({0xB8}); e.imm32(instr.cycles.first);     //  mov eax, ticks
+                e.bytes({0xB9}); e.imm32(instr.cycles.second);    //  mov ecx, branch ticks
+                e.bytes({0x0F,0x45,0xC1});                      //  cmovne eax, ecx
+                e.add_cycles_rax();
+            } else
+                e.add_cycles_imm32(instr.cycles.first);
+        }
+        if(last)
+            break;
+        //  leave the block once an event is due, exactly where the interpreter would.
+        e.mov_rax_cycles();
+        e.mov_r64_imm64(x64_emitter_t::RDX, reinterpret_cast<uint64_t>(&gb.scheduler.next_stamp));
+        e.bytes({0x48,0x3B,0x02});                              //  cmp rax, [rdx]
+        exits.push_back(e.jcc_rel32(0x3));                      //  jae
+        if(!native){
+            e.mov_r64_imm64(x64_emitter_t::RAX, reinterpret_cast<uint64_t>(&gb.halted));
+            e.bytes({0x80,0x38,0x00});                          //  cmp byte [rax], 0
+            exits.push_back(e.jcc_rel32(0x5));                  //  jne
+            e.mov_r64_imm64(x64_emitter_t::RAX, reinterpret_cast<uint64_t>(&gb.interrupt_check));
+            e.bytes({0x80,0x38,0x00});
+            exits.push_back(e.jcc_rel32(0x5));
+            e.mov_r64_imm64(x64_emitter_t::RAX, reinterpret_cast<uint64_t>(&gb.dbg_paused));
+            e.bytes({0x80,0x38,0x00});
+            exits.push_back(e.jcc_rel32(0x5));
+            //  the rest of the block is rom, which oam dma hides from the cpu.
+            e.mov_r64_imm64(x64_emitter_t::RAX, reinterpret_cast<uint64_t>(&gb.mem.oam_dma_active));
+            e.bytes({0x80,0x38,0x00});
+            exits.push_back(e.jcc_rel32(0x5));
+        }
+    }
+    for(auto at: exits)
+        e.patch_rel32(at, e.code.size());
+    e.bytes({0x41,0x5D, 0x41,0x5C, 0x5B, 0xC3});                //  pop r13; pop r12; pop rbx; ret
+    if(used+e.code.size() > CODE_BUFFER_SIZE){
+        //  out of space, start over and let hot blocks be translated again.
+        gb.blocks.drop_native();
+        used = 0;
+    }
+    uint8_t* dest = buffer.get()+used;
+    std::memcpy(dest, e.code.data(), e.code.size());
+    used += e.code.size();
+    block.native = reinterpret_cast<_cpu_function_prototype>(dest);
+    return true;
+#else
+    return false;
+#endif
+}
\ No newline at end of file
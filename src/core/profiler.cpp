@@ -0,0 +1,59 @@
+#include<core/profiler.h>
+#include<iomanip>
+
+void profiler_t::reset(){
+    noncb = {};
+    cb = {};
+    regions = {};
+}
+
+const char* profiler_t::get_region_name(size_t region){
+    constexpr std::array<const char*,MEMORY_TYPE_COUNT> names = {
+        "rom0", "rom1", "vram", "ram", "wram", "mirror", "oam", "illegal", "io", "hram"
+    };
+    return names[region];
+}
+
+void profiler_t::export_csv(std::ostream& os) const{
+    os << "range,opcode,mnemonic,executions,cycles\n";
+    auto write_range = [&](const char* range, const auto& entries, bool is_cb){
+        for(size_t i = 0; i < entries.size(); ++i){
+            if(!entries[i].executions)
+                continue;
+            os << range << ",0x" << std::hex << std::setw(2) << std::setfill('0') << std::uppercase << i << std::dec
+                << ",\"" << disassembler_t::get_opcode_name(i, is_cb) << "\","
+                << entries[i].executions << "," << entries[i].cycles << "\n";
+        }
+    };
+    write_range("noncb", noncb, false);
+    write_range("cb", cb, true);
+    for(size_t i = 0; i < regions.size(); ++i){
+        if(regions[i].executions)
+            os << "region," << get_region_name(i) << ",," << regions[i].executions << "," << regions[i].cycles << "\n";
+    }
+}
+
+void profiler_t::export_json(std::ostream& os) const{
+    auto write_range = [&](const auto& entries, bool is_cb){
+        bool first = true;
+        os << "[";
+        for(size_t i = 0; i < entries.size(); ++i){
+            if(!entries[i].executions)
+                continue;
+            os << (first ? "" : ",") << "\n    {\"opcode\":" << i << ",\"mnemonic\":\"" << disassembler_t::get_opcode_name(i, is_cb)
+                << "\",\"executions\":" << entries[i].executions << ",\"cycles\":" << entries[i].cycles << "}";
+            first = false;
+        }
+        os << "\n  ]";
+    };
+    os << "{\n  \"noncb\":";
+    write_range(noncb, false);
+    os << ",\n  \"cb\":";
+    write_range(cb, true);
+    os << ",\n  \"regions\":{";
+    for(size_t i = 0; i < regions.size(); ++i){
+        os << (i ? "," : "") << "\n    \"" << get_region_name(i) << "\":{\"executions\":" << regions[i].executions 
+            << ",\"cycles\":" << regions[i].cycles << "}";
+    }
+    os << "\n  }\n}\n";
+}
\ No newline at end of file
@@ -678,6 +678,20 @@ std::string disassembler_t::disassemble(uint8_t opc, uint16_t offset, uint16_t i
     }
 }
 
+std::string disassembler_t::get_opcode_name(uint8_t opc, bool cb){
+    if(cb)
+        return cb_mnemonic[opc];
+    std::string str = noncb_mnemonic[opc];
+    if(size_t pos = str.find('%'); pos != std::string::npos){
+        switch(str[pos+1]){
+        case '1': str.replace(pos, 2, "n8");  break;
+        case '2': str.replace(pos, 2, "n16"); break;
+        case '-': str.replace(pos, 2, "e8");  break;
+        }
+    }
+    return str;
+}
+
 std::string disassembler_t::labelify_opc(uint8_t opc, uint16_t offset, uint16_t imm){
     uint16_t adr;
     if(
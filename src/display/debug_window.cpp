@@ -6,6 +6,9 @@
 #include<core/instructions.h>
 #include<array>
 #include<map>
+#include<vector>
+#include<algorithm>
+#include<fstream>
 
 const std::string dbg_window::imgui_win_id = "dbg_debug_window";
 float dbg_window::size_x = 1000, dbg_window::size_y = 600;
@@ -16,6 +19,7 @@ disassembler_t disasm;
 std::map<uint16_t, std::string> disassembly;
 std::unordered_map<uint16_t, std::string> labels;
 uint16_t breakpoint_insert;
+uint16_t breakpoint_range_end;
 std::string search_string;
 constexpr size_t search_str_size = 256;
 
@@ -38,6 +42,17 @@ void dbg_window::on_pause(){
 
 void dbg_window::on_play(){}
 
+void dbg_window::attach(){
+    gameboy->set_debug_policy(debug_policy::INSTRUMENTED);
+    on_pause();
+}
+
+void dbg_window::detach(){
+    //  nothing could resume a paused emulator with the window closed.
+    gameboy->dbg_paused = false;
+    gameboy->set_debug_policy(debug_policy::FAST);
+}
+
 void dbg_window::disassemble(uint16_t adr){
     auto& gb = *gameboy;
     bool is_cb;
@@ -93,6 +108,7 @@ void dbg_window::draw(){
         draw_control_subwindow();
         ImGui::End();
     }
+    draw_profiler_window();
 }
 
 void dbg_window::draw_reg_subwindow(){
@@ -238,9 +254,12 @@ void dbg_window::draw_control_subwindow(){
         ImGui::SameLine();
         if(ImGui::Button("remove")){
             gb.dbg_code_breakpoints.erase(breakpoint_insert);
-            gb.mem.dbg_write_breakpoints.erase(breakpoint_insert);
-            gb.mem.dbg_read_breakpoints.erase(breakpoint_insert);
+            gb.mem.dbg_write_breakpoints.remove(breakpoint_insert);
+            gb.mem.dbg_read_breakpoints.remove(breakpoint_insert);
         }
+        //  read and write watchpoints cover up to this address, the start alone when it lies below.
+        ImGui::InputScalar("to", ImGuiDataType_U16, &breakpoint_range_end, nullptr, nullptr, "%04X", 
+            ImGuiInputTextFlags_CharsHexadecimal);
         ImGui::Text("breakpoint: ");
         ImGui::SameLine();
         if(ImGui::Button("code")){
@@ -248,11 +267,11 @@ void dbg_window::draw_control_subwindow(){
         }
         ImGui::SameLine();
         if(ImGui::Button("write")){
-            gb.mem.dbg_write_breakpoints[breakpoint_insert] = true;
+            gb.mem.dbg_write_breakpoints.add(breakpoint_insert, std::max(breakpoint_insert, breakpoint_range_end));
         }
         ImGui::SameLine();
         if(ImGui::Button("read")){
-            gb.mem.dbg_read_breakpoints[breakpoint_insert] = true;
+            gb.mem.dbg_read_breakpoints.add(breakpoint_insert, std::max(breakpoint_insert, breakpoint_range_end));
         }
         if(ImGui::BeginChild("breakpoints",{0,0},true)){
             ImGui::Text("code breakpoints:");
@@ -267,19 +286,25 @@ void dbg_window::draw_control_subwindow(){
             }
             ImGui::Text("\nwrite breakpoints:");
             if(ImGui::BeginTable("write breakpoints", 1)){
-                for(auto& entry: gb.mem.dbg_write_breakpoints){
+                for(auto& range: gb.mem.dbg_write_breakpoints.get_ranges()){
                     ImGui::TableNextRow();
                     ImGui::TableSetColumnIndex(0);
-                    ImGui::Text("%04X", entry.first);
+                    if(range.first == range.second)
+                        ImGui::Text("%04X", range.first);
+                    else
+                        ImGui::Text("%04X-%04X", range.first, range.second);
                 }
                 ImGui::EndTable();
             }
             ImGui::Text("\nread breakpoints:");
             if(ImGui::BeginTable("read breakpoints", 1)){
-                for(auto& entry: gb.mem.dbg_read_breakpoints){
+                for(auto& range: gb.mem.dbg_read_breakpoints.get_ranges()){
                     ImGui::TableNextRow();
                     ImGui::TableSetColumnIndex(0);
-                    ImGui::Text("%04X", entry.first);
+                    if(range.first == range.second)
+                        ImGui::Text("%04X", range.first);
+                    else
+                        ImGui::Text("%04X-%04X", range.first, range.second);
                 }
                 ImGui::EndTable();
             }
@@ -288,3 +313,85 @@ void dbg_window::draw_control_subwindow(){
         ImGui::EndChild();
     }
 }
+
+
+void dbg_window::draw_profiler_window(){
+    auto& gb = *gameboy;
+    if(!ImGui::Begin("profiler")){
+        ImGui::End();
+        return;
+    }
+    bool profiling = gb.is_profiling();
+    if(ImGui::Checkbox("enabled", &profiling))
+        gb.set_profiling(profiling);
+    ImGui::SameLine();
+    if(ImGui::Button("clear"))
+        gb.profiler.reset();
+    ImGui::SameLine();
+    if(ImGui::Button("export csv")){
+        std::ofstream os{"profile.csv"};
+        gb.profiler.export_csv(os);
+    }
+    ImGui::SameLine();
+    if(ImGui::Button("export json")){
+        std::ofstream os{"profile.json"};
+        gb.profiler.export_json(os);
+    }
+    //  one row per executed opcode, followed by the memory regions.
+    struct row_t{ std::string name; uint16_t opcode; const profile_entry_t* entry; };
+    std::vector<row_t> rows;
+    for(size_t i = 0; i < 256; ++i){
+        if(gb.profiler.get_noncb()[i].executions)
+            rows.push_back({disassembler_t::get_opcode_name(i, false), (uint16_t)i, &gb.profiler.get_noncb()[i]});
+        if(gb.profiler.get_cb()[i].executions)
+            rows.push_back({disassembler_t::get_opcode_name(i, true), (uint16_t)(0xCB00|i), &gb.profiler.get_cb()[i]});
+    }
+    const ImGuiTableFlags flags = ImGuiTableFlags_Sortable | ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg;
+    if(ImGui::BeginTable("opcode profile", 4, flags, {0, size_y/1.5f})){
+        ImGui::TableSetupColumn("opcode", ImGuiTableColumnFlags_DefaultSort);
+        ImGui::TableSetupColumn("mnemonic");
+        ImGui::TableSetupColumn("executions", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("cycles", ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableHeadersRow();
+        if(ImGuiTableSortSpecs* specs = ImGui::TableGetSortSpecs(); specs && specs->SpecsCount){
+            const auto& spec = specs->Specs[0];
+            auto compare = [](auto a, auto b){ return (a > b)-(a < b); };
+            std::stable_sort(rows.begin(), rows.end(), [&](const row_t& a, const row_t& b){
+                int order;
+                switch(spec.ColumnIndex){
+                case 1:  order = a.name.compare(b.name);                                break;
+                case 2:  order = compare(a.entry->executions, b.entry->executions);    break;
+                case 3:  order = compare(a.entry->cycles, b.entry->cycles);            break;
+                default: order = compare(a.opcode, b.opcode);
+                }
+                return spec.SortDirection == ImGuiSortDirection_Ascending ? order < 0 : order > 0;
+            });
+        }
+        for(const auto& row: rows){
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text(row.opcode > 0xFF ? "%04X" : "%02X", row.opcode);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%s", row.name.c_str());
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%zu", row.entry->executions);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%zu", row.entry->cycles);
+        }
+        ImGui::EndTable();
+    }
+    if(ImGui::BeginTable("region profile", 3)){
+        for(size_t i = 0; i < profiler_t::MEMORY_TYPE_COUNT; ++i){
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%s", profiler_t::get_region_name(i));
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%zu", gb.profiler.get_regions()[i].executions);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%zu", gb.profiler.get_regions()[i].cycles);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
\ No newline at end of file
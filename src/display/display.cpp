@@ -89,7 +89,8 @@ void main_window::draw(){
 void main_window::draw_main_menu(){
     if(ImGui::BeginMainMenuBar()){
         if(ImGui::BeginMenu("Debug")){
-            ImGui::MenuItem("Debugger", nullptr, reinterpret_cast<bool*>(&enable_debug_window));
+            if(ImGui::MenuItem("Debugger", nullptr, reinterpret_cast<bool*>(&enable_debug_window)))
+                enable_debug_window ? dbg_window::attach() : dbg_window::detach();
             ImGui::EndMenu();
         }
         ImGui::EndMainMenuBar();
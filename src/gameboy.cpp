@@ -13,7 +13,10 @@ gameboy_t::gameboy_t(){
 }
 
 void gameboy_t::init(){
-#ifdef __DEBUG__
+    //  scheduler events.
+    scheduler.set_handler(scheduler_event::TIMER, [this](){ timer.update(); });
+    scheduler.set_handler(scheduler_event::PPU, [this](){ ppu.update(); });
+    scheduler.set_handler(scheduler_event::OAM_DMA, [this](){ mem.finish_oam_dma(); });
     //  memory callbacks.
     mem.dbg_unbind_bootrom_callbk = [&](){
         main_window::bind(*this);
@@ -44,55 +47,155 @@ void gameboy_t::init(){
             dbg_recent_instr_deque.pop_back();
     };
     dbg_code_breakpoints[0x101] = true;
-#endif
 }
 
 void gameboy_t::dbg_reset(){
     dbg_mutex.lock();
     std::string cur_rom = this->mem.get_rom_path();
     auto breakpoints = this->dbg_code_breakpoints;
+    auto policy = this->policy;
+    auto fast_boot = this->fast_boot;
+    auto engine = this->ppu.get_engine();
+    auto core = this->core;
+    auto profiling = this->profiling;
     *this = gameboy_t{};
+    //  the components still point at the temporary.
+    mem.gb = this;
+    timer.gb = this;
+    ppu.gb = this;
     init();
     this->dbg_paused = true;
     this->dbg_code_breakpoints = breakpoints;
+    this->policy = policy;
+    this->mem.set_debug_policy(policy);
+    this->fast_boot = fast_boot;
+    this->ppu.set_engine(engine);
     this->load_rom(cur_rom);
     dbg_mutex.unlock();
+    //  the setters take the lock themselves and redo the fusion setting, the reset left the debugger paused meanwhile.
+    set_cpu_core(core);
+    set_profiling(profiling);
+}
+
+void gameboy_t::load_rom(const std::string& path){
+    //  blocks are keyed by address and bank only, they'd outlive the rom they were decoded from.
+    blocks.clear();
+    jit.reset();
+    mem.load_rom(path, fast_boot);
+    if(fast_boot){
+        regs.get<RI::AF>() = 0x01B0;
+        regs.get<RI::BC>() = 0x0013;
+        regs.get<RI::DE>() = 0x00D8;
+        regs.get<RI::HL>() = 0x014D;
+        regs.get<RI::SP>() = 0xFFFE;
+        regs.get<RI::PC>() = 0x0100;
+    }
 }
 
 void gameboy_t::update(){
-#ifdef __DEBUG__
     while(dbg_paused){
         if(dbg_should_step){
             dbg_should_step = false;
             break;
         }
     }
-#endif
     dbg_mutex.lock();
+    step(THREADED_SLICE);
+    dbg_mutex.unlock();
+}
+
+void gameboy_t::run_for_cycles(size_t n){
+    //  single stepping in the debugger keeps going through update.
+    if(dbg_paused)
+        return update();
+    const size_t deadline = scheduler.get_cycles()+n;
+    dbg_mutex.lock();
+    while(!dbg_paused && scheduler.get_cycles() < deadline)
+        step(deadline-scheduler.get_cycles());
+    dbg_mutex.unlock();
+}
+
+void gameboy_t::run_until_vblank(){
+    if(dbg_paused)
+        return update();
+    //  no vblank comes with the lcd off, a frame's worth of cycles still paces the display.
+    const size_t frame = ppu.get_frame_count();
+    const size_t deadline = scheduler.get_cycles()+CYCLES_PER_FRAME;
+    dbg_mutex.lock();
+    while(!dbg_paused && ppu.get_frame_count() == frame && scheduler.get_cycles() < deadline)
+        step(deadline-scheduler.get_cycles());
+    dbg_mutex.unlock();
+}
+
+void gameboy_t::set_debug_policy(debug_policy policy){
+    //  the lock is only released between steps, so no step runs half of each.
+    std::lock_guard lock{dbg_mutex};
+    this->policy = policy;
+    mem.set_debug_policy(policy);
+}
+
+void gameboy_t::set_cpu_core(cpu_core core){
+    std::lock_guard lock{dbg_mutex};
+    this->core = core;
+    update_fusion();
+}
+
+void gameboy_t::set_profiling(bool enable){
+    std::lock_guard lock{dbg_mutex};
+    profiling = enable;
+    update_fusion();
+}
+
+void gameboy_t::step(size_t budget){
+    if(policy == debug_policy::FAST)
+        step<debug_policy::FAST>(budget);
+    else
+        step<debug_policy::INSTRUMENTED>(budget);
+}
+
+template<debug_policy policy>
+void gameboy_t::step(size_t budget){
     while(scheduler.is_event_pending()){
         scheduler.process_events();
     }
-    fetch_decode_execute();
-    dbg_mutex.unlock();
+    if(interrupt_check || (halted && mem.get_pending_interrupts()))
+        handle_interrupts();
+    //  nothing but an interrupt can wake the cpu, so there's no point ticking through the wait.
+    if(halted)
+        return scheduler.fast_forward(budget);
+    //  single stepping and oam dma always go through the table interpreter, as does the boot rom for cached cores.
+    if(dbg_paused || mem.is_oam_dma_active())
+        fetch_decode_execute<policy>();
+    else if(core == cpu_core::THREADED){
+        //  the table interpreter reports invalid instructions, keeping the exception handling off the threaded loop.
+        if(!instr_table::run_threaded<policy>(*this, budget))
+            fetch_decode_execute<policy>();
+    }
+    else if(core != cpu_core::INTERPRETER && !mem.is_boot_rom_bound())
+        execute_block<policy>(budget);
+    else
+        fetch_decode_execute<policy>();
 }
 
+template<debug_policy policy>
 void gameboy_t::fetch_decode_execute(){
     auto& pc = regs.get<RI::PC>();
-#ifdef __DEBUG__
     auto prev_pc = pc;
-#endif
     cpu_function_argument_t arg{*this};
     cpu_function_entry instr;
     size_t instr_size;
-    uint8_t opcode = mem.read(pc);
+    uint8_t opcode = mem.read<policy>(pc);
     if(opcode==0xCB){
-        instr = instr_table::cb_range[mem.read(pc+1)];
+        arg.operand = mem.read_operand(pc+1, 1);
+        instr = instr_table::cb_range[arg.operand];
         instr_size = 2;
     } else{
         instr = instr_table::noncb_range[opcode];
         instr_size = entry_get<CPU_ENTRY::BYTE_LENGTH>(instr);
+        if(instr_size > 1)
+            arg.operand = mem.read_operand(pc+1, instr_size-1);
     }
-    pc += instr_size*(!halted);
+    pc += instr_size;
     try{
         entry_get<CPU_ENTRY::FUNCTION>(instr)(arg);
     } catch(std::runtime_error& e){
@@ -101,73 +204,121 @@ void gameboy_t::fetch_decode_execute(){
         std::abort();
     }
     auto cycles = entry_get<CPU_ENTRY::CYCLES>(instr);
-    scheduler.tick_system(arg.did_branch ? cycles.first : cycles.second);
-    //  debugging
-#ifdef __DEBUG__
+    const size_t ticks = arg.did_branch ? cycles.second : cycles.first;
+    scheduler.tick_system(ticks);
+    if(profiling)
+        profiler.record(prev_pc, opcode, arg.operand, ticks);
+    if constexpr(policy == debug_policy::INSTRUMENTED)
+        dbg_instruction_hook(prev_pc, opcode, instr_size, arg.operand, arg.did_branch);
+}
+
+template<debug_policy policy>
+void gameboy_t::execute_block(size_t budget){
+    auto& pc = regs.get<RI::PC>();
+    basic_block_t* block = blocks.find(pc, mem.get_rom_bank(pc));
+    if(!block && !(block = blocks.build(mem, pc, mem.get_rom_bank(pc))))
+        return fetch_decode_execute<policy>();
+    //  translated code skips the per instruction hooks, so the instrumented core stays on predecoded blocks.
+    constexpr bool allow_native = policy == debug_policy::FAST;
+    if(allow_native && core == cpu_core::JIT && !profiling && !block->native && ++block->executions == jit_t::HOT_THRESHOLD)
+        jit.compile(*this, *block);
+    const size_t start = scheduler.get_cycles();
+    const uint16_t start_af = block->idle ? regs.get<RI::AF>() : 0;
+    if(allow_native && block->native && !profiling){
+        cpu_function_argument_t arg{*this};
+        block->native(arg);
+    } else if(!execute_predecoded<policy>(*block))
+        return;
+    if(block->idle && !profiling && pc == block->start_adr && regs.get<RI::AF>() == start_af && !scheduler.is_event_pending())
+        skip_idle_loop(*block, scheduler.get_cycles()-start, start+budget);
+}
+
+template<debug_policy policy>
+bool gameboy_t::execute_predecoded(const basic_block_t& block){
+    auto& pc = regs.get<RI::PC>();
+    const size_t generation = blocks.get_generation();
+    //  copied, a write to the block's own page frees it while its instruction is still executing.
+    for(auto instr: block.instrs){
+        auto prev_pc = pc;
+        cpu_function_argument_t arg{*this, instr.operand};
+        pc += instr.length;
+        try{
+            instr.function(arg);
+        } catch(std::runtime_error& e){
+            std::cout << "application quit with the following exception:" << std::endl;
+            std::cout << e.what() << std::endl;
+            std::abort();
+        }
+        if(!arg.did_split)
+            scheduler.tick_system(arg.did_branch ? instr.cycles.second : instr.cycles.first);
+        if(profiling)
+            profiler.record(prev_pc, instr.opcode, instr.operand, arg.did_branch ? instr.cycles.second : instr.cycles.first);
+        if constexpr(policy == debug_policy::INSTRUMENTED){
+            dbg_instruction_hook(prev_pc, instr.opcode, pc-prev_pc, instr.operand, arg.did_branch);
+            if(dbg_paused)
+                return false;
+        }
+        //  a write to the block's own page frees it, so the rest has to be decoded again.
+        if(halted || interrupt_check || generation != blocks.get_generation() || scheduler.is_event_pending() || mem.is_oam_dma_active())
+            return false;
+    }
+    return true;
+}
+
+void gameboy_t::skip_idle_loop(const basic_block_t& block, size_t iteration, size_t limit){
+    //  the loop can't see a change before the next event, so whole iterations up to it are skipped.
+    if(block.idle_reads_hl && memory_t::is_time_dependent(regs.get<RI::HL>()))
+        return;
+    if(policy == debug_policy::INSTRUMENTED && mem.dbg_read_breakpoints.any())
+        return;
+    limit = std::min<size_t>(limit, scheduler.get_next_stamp());
+    const size_t now = scheduler.get_cycles();
+    if(iteration && limit > now)
+        scheduler.tick_system((limit-1-now)/iteration*iteration);
+}
+
+void gameboy_t::dbg_instruction_hook(uint16_t prev_pc, uint8_t opcode, size_t instr_size, uint16_t operand, bool did_branch){
+    auto& pc = regs.get<RI::PC>();
     if(dbg_instruction_execute_callbk){
         dbg_instruction_execute_callbk(prev_pc, 
-            dbg_disasm.disassemble(opcode, prev_pc+instr_size, immediate16()));
+            dbg_disasm.disassemble(opcode, prev_pc+instr_size, operand));
     }
-    if(disassembler_t::is_call(opcode) && arg.did_branch){
+    if(disassembler_t::is_call(opcode) && did_branch){
         if(dbg_enter_call_callbk)
             dbg_enter_call_callbk(prev_pc, pc);
-    } else if(disassembler_t::is_ret(opcode) && arg.did_branch){
+    } else if(disassembler_t::is_ret(opcode) && did_branch){
         if(dbg_ret_from_call_callbk)
             dbg_ret_from_call_callbk();
     }
     if(dbg_code_breakpoints.size() > 0){
         if(dbg_code_breakpoints.contains(pc)){
             if(dbg_code_breakpoints[pc] && dbg_code_breakpoints_callbk)
-                dbg_code_breakpoints_callbk(pc, opcode, immediate16());
+                dbg_code_breakpoints_callbk(pc, opcode, operand);
         }
     }
-#endif
-}
-
-uint8_t gameboy_t::immediate8(){
-    return mem.read(regs.get<RI::PC>()-1); 
-}
-
-uint16_t gameboy_t::immediate16(){
-    return mem.read(regs.get<RI::PC>() - 2) | (mem.read(regs.get<RI::PC>() - 1) <<8);
 }
 
 void gameboy_t::handle_interrupts(){
-    auto ie_var = mem.read(IE_ADR); 
-    auto if_var = mem.read(IF_ADR);
-    if(ie_var & if_var & 0x1F){
-        if(halted){
-            halted = false;
-            regs.get<RI::PC>()+=1;
-            scheduler.tick_system(4);
-        }
-        if(ime){
-            scheduler.tick_system(20);  //  tick 5 machine cycles
-            auto& sp = regs.get<RI::SP>();
-            mem.write(--sp, regs.get<RI::PC>() >> 8);
-            mem.write(--sp, regs.get<RI::PC>());
-            switch(if_var & ie_var){
-            case 0x01: 
-                regs.get<RI::PC>() = 0x40; 
-                mem.write(IF_ADR, if_var ^ 0x01);
-                break;
-            case 0x02:
-                regs.get<RI::PC>() = 0x48;
-                mem.write(IF_ADR, if_var ^ 0x02);
-                break;
-            case 0x04:
-                regs.get<RI::PC>() = 0x50;
-                mem.write(IF_ADR, if_var ^ 0x04);
-                break;
-            case 0x08:
-                regs.get<RI::PC>() = 0x58;
-                mem.write(IF_ADR, if_var ^ 0x08);
-                break;
-            case 0x10:
-                regs.get<RI::PC>() = 0x60;
-                mem.write(IF_ADR, if_var ^ 0x10);
-            }
-            ime = false;
-        }
+    const uint8_t pending = mem.get_pending_interrupts();
+    if(halted && pending){
+        //  pc already points past the halt.
+        halted = stopped = false;
+        scheduler.tick_system(4);
+    }
+    if(ei_delay){
+        //  the instruction following ei still runs before any interrupt.
+        set_ime(true);
+        return;
     }
+    if(!ime || !pending)
+        return;
+    scheduler.tick_system(20);  //  tick 5 machine cycles
+    auto& sp = regs.get<RI::SP>();
+    mem.write(--sp, regs.get<RI::PC>() >> 8);
+    mem.write(--sp, regs.get<RI::PC>());
+    //  the lowest bit wins, vectors are 8 bytes apart from 0x40.
+    const uint8_t bit = pending & -pending;
+    regs.get<RI::PC>() = 0x40+__builtin_ctz(bit)*8;
+    set_ime(false);
+    mem.acknowledge_interrupt(bit);
 }
\ No newline at end of file
@@ -12,6 +12,6 @@ int main(){
     main_window::init();
     main_window::start();
     while(true){
-        gb.update();
+        gb.run_until_vblank();
     }
 }
\ No newline at end of file
@@ -3,23 +3,16 @@
 #include<iostream>
 #include<gameboy.h>
 
-enum class interrupt_bit{
-    VBLANK      = 0,
-    LCD_STAT    = 0b10,
-    TIMER       = 0b100,
-    SERIAL      = 0b1000,
-    JOYPAD      = 0b10000
-};
-
+template<debug_policy policy>
 uint8_t memory_t::read(uint16_t adr){
-#ifdef __DEBUG__
-    if(dbg_read_breakpoints.size() > 0){
-        if(dbg_read_breakpoints.contains(adr)){
-            if(dbg_read_breakpoints[adr] && dbg_read_breakpoint_callbk)
-                dbg_read_breakpoint_callbk(adr);
-        }
+    if constexpr(policy == debug_policy::INSTRUMENTED){
+        if(dbg_read_breakpoints.any() && dbg_read_breakpoints.contains(adr) && dbg_read_breakpoint_callbk)
+            dbg_read_breakpoint_callbk(adr);
     }
-#endif 
+    if(const uint8_t* page = read_pages[adr>>8])
+        return page[adr&0xFF];
+    if(oam_dma_active && adr < 0xFF00)
+        return 0xFF;
     if(adr < 0x8000){
         if(boot_rom_bound && adr == 0x0100)
             unbind_boot_rom();
@@ -41,77 +34,113 @@ uint8_t memory_t::read(uint16_t adr){
     }
 }
 
+template uint8_t memory_t::read<debug_policy::FAST>(uint16_t adr);
+template uint8_t memory_t::read<debug_policy::INSTRUMENTED>(uint16_t adr);
+
+uint16_t memory_t::read_operand(uint16_t adr, size_t bytes){
+    const uint8_t* p = read_pages[adr>>8];
+    if(p && adr < 0x8000 && (adr&0xFF)+bytes <= 0x100){
+        p += adr&0xFF;
+        return bytes == 2 ? p[0]|(p[1]<<8) : p[0];
+    }
+    return bytes == 2 ? read(adr)|(read(adr+1)<<8) : read(adr);
+}
+
 uint8_t memory_t::read_io(uint16_t adr){
     switch(adr){
-    case 0xFF04: return ((div_timestamp+gb->scheduler.get_cycles())/256);   //  DIV
+    case 0xFF04 ... 0xFF07: return gb->timer.read(adr);   //  DIV, TIMA, TMA, TAC
+    case 0xFF40 ... 0xFF45:
+    case 0xFF47 ... 0xFF4B: return gb->ppu.read(adr);     //  lcd registers
+    case 0xFF46:            return oam_dma_page;
+    case 0xFF51 ... 0xFF55:
+        if(mbc->is_cgb())
+            return adr == 0xFF55 ? hdma_status : 0xFF;
+        break;
     }
     return io_regs[adr-0xFF00];
 }
 
+template<debug_policy policy>
 void memory_t::write(uint16_t adr, uint8_t val){
-#ifdef __DEBUG__
-    if(adr == 0xFF01){
-        std::cout << val;
+    if constexpr(policy == debug_policy::INSTRUMENTED){
+        if(dbg_write_breakpoints.any() && dbg_write_breakpoints.contains(adr) && dbg_write_breakpoint_callbk)
+            dbg_write_breakpoint_callbk(adr, val);
     }
-    if(dbg_write_breakpoints.size() > 0){
-        if(dbg_write_breakpoints.contains(adr)){
-            if(dbg_write_breakpoints[adr] && dbg_write_breakpoint_callbk)
-                dbg_write_breakpoint_callbk(adr, val);
-        }
+    if(uint8_t* page = write_pages[adr>>8]){
+        page[adr&0xFF] = val;
+        return;
     }
-#endif
+    if(oam_dma_active && adr < 0xFF00)
+        return;
     if(adr < 0x8000){
         mbc->rom_write(adr, val);
+        //  a ram bank switch leaves any cached code in cart ram stale.
+        gb->blocks.invalidate(*this, 0xA000, 0xBFFF);
+        remap(0x40, 0x7F);
+        remap(0xA0, 0xBF);
     } else{
+        if(gb->blocks.is_code(adr))
+            gb->blocks.invalidate(*this, adr, adr);
         switch (adr){
-        case 0x8000 ... 0x9FFF: mbc->write_vram(adr-0x8000, val);          break;
+        case 0x8000 ... 0x9FFF: gb->ppu.on_vram_write(adr);
+                                mbc->write_vram(adr-0x8000, val);          break;
         case 0xA000 ... 0xBFFF: mbc->write_ram(adr-0xA000, val);           break;
         case 0xC000 ... 0xCFFF: wram[adr-0xC000]                    = val; break;
         case 0xD000 ... 0xDFFF: mbc->write_wram(adr-0xD000, val);          break;
         case 0xE000 ... 0xEFFF: wram[adr-0xE000]                    = val; break;
         case 0xF000 ... 0xFDFF: mbc->write_wram(adr-0xF000, val);          break;
-        case 0xFE00 ... 0xFE9F: oam[adr-0xFE00]                     = val; break;
+        case 0xFE00 ... 0xFE9F: gb->ppu.on_oam_write(adr, val);
+                                oam[adr-0xFE00]                     = val; break;
         case 0xFEA0 ... 0xFEFF: illegal[adr-0xFEA0]                 = val; break;
         case 0xFF00 ... 0xFF7F: write_io(adr, val);                        break;
         case 0xFF80 ... 0xFFFE: hram[adr-0xFF80]                    = val; break;
-        default:                gb->scheduler.add_event(1, {[&](){ gb->handle_interrupts(); }, scheduler_event::IE_WRITE});
-                                ie = val;
+        default:                ie = val;
+                                update_pending_interrupts();
         }
     }
 }
 
+template void memory_t::write<debug_policy::FAST>(uint16_t adr, uint8_t val);
+template void memory_t::write<debug_policy::INSTRUMENTED>(uint16_t adr, uint8_t val);
+
+void memory_t::request_interrupt(interrupt_bit bit){
+    io_regs[0x0F] |= (uint8_t)bit;
+    update_pending_interrupts();
+}
+
+void memory_t::acknowledge_interrupt(uint8_t bit){
+    io_regs[0x0F] &= ~bit;
+    update_pending_interrupts();
+}
+
+void memory_t::update_pending_interrupts(){
+    pending_interrupts = ie & io_regs[0x0F] & 0x1F;
+    gb->update_interrupt_check();
+}
+
 void memory_t::write_io(uint16_t adr, uint8_t val){
     switch(adr){
-    case 0xFF04:    //  DIV
-        div_timestamp = gb->scheduler.get_cycles();
+    case 0xFF01:    //  SB, echoed for the test roms reporting through the serial port.
+        std::cout << val;
         break;
-    case 0xFF06:    //  TMA
-    case 0xFF07:    //  TAC
-        io_regs[adr-0xFF00] = val;
-        if(read(0xFF07)&0b100){
-            auto lambda = [&](){
-                io_regs[0x0F] |= (uint8_t)interrupt_bit::TIMER;
-                gb->handle_interrupts();
-                return;
-            };
-            switch(read(0xFF07)&0b11){
-            case 0b00:
-                gb->scheduler.add_event((0x100-read(0xFF05))*1024, {lambda, scheduler_event::TIMER});
-                break;
-            case 0b01:
-                gb->scheduler.add_event((0x100-read(0xFF05))*16, {lambda, scheduler_event::TIMER});
-                break;
-            case 0b10:
-                gb->scheduler.add_event((0x100-read(0xFF05))*64, {lambda, scheduler_event::TIMER});
-                break;
-            case 0b11:
-                gb->scheduler.add_event((0x100-read(0xFF05))*256, {lambda, scheduler_event::TIMER});
-                break;
-            }    
-        }
+    case 0xFF04 ... 0xFF07: //  DIV, TIMA, TMA, TAC
+        gb->timer.write(adr, val);
+        return;
+    case 0xFF40 ... 0xFF45: //  lcd registers
+    case 0xFF47 ... 0xFF4B:
+        gb->ppu.write(adr, val);
         return;
+    case 0xFF46:    //  DMA
+        start_oam_dma(val);
+        return;
+    case 0xFF51 ... 0xFF55: //  HDMA1-5, cgb only.
+        if(mbc->is_cgb())
+            return write_hdma(adr, val);
+        break;
     case IF_ADR:
-        gb->scheduler.add_event(1, {[&](){ gb->handle_interrupts(); }, scheduler_event::IF_WRITE});
+        io_regs[0x0F] = val;
+        update_pending_interrupts();
+        return;
     }
     io_regs[adr-0xFF00] = val;
 }
@@ -127,81 +156,256 @@ uint8_t memory_t::debug_read(uint16_t adr){ //  doesn't unbind boot rom.
     case 0xF000 ... 0xFDFF: return mbc->read_wram(adr-0xF000);
     case 0xFE00 ... 0xFE9F: return oam[adr-0xFE00];
     case 0xFEA0 ... 0xFEFF: return illegal[adr-0xFEA0];
-    case 0xFF00 ... 0xFF7F: return io_regs[adr-0xFF00];
+    case 0xFF00 ... 0xFF7F: return read_io(adr);
     case 0xFF80 ... 0xFFFE: return hram[adr-0xFF80];
     }
     return ie;
 }
 
-void memory_t::load_rom(const std::string& path){
+void memory_t::load_rom(const std::string& path, bool fast_boot){
     rom_path = path;
-    std::ifstream stream{path, std::ios::binary|std::ios::ate};
-    if(!stream)
-        throw std::runtime_error("unable to locate rom");
-    std::vector<char> rom_data(stream.tellg());
-    stream.seekg(std::ios::beg);
-    stream.read(rom_data.data(), rom_data.size());
-    allocate_mbc_type(rom_data[0x0147]);
-    mbc->load_rom(rom_data);
-    bind_boot_rom();
+    auto image = rom_image_t::open(path);
+    allocate_mbc_type(image->data()[0x0147]);
+    mbc->load_rom(std::move(image));
+    if(fast_boot)
+        apply_post_boot_state();
+    else
+        bind_boot_rom();
+}
+
+//  dmg values at 0x0100, written directly so none of the io side effects get scheduled.
+void memory_t::apply_post_boot_state(){
+    static constexpr std::array<std::pair<uint16_t,uint8_t>,19> post_boot_io{{
+        {0xFF0F,0xE1},
+        {0xFF10,0x80}, {0xFF11,0xBF}, {0xFF12,0xF3}, {0xFF14,0xBF}, {0xFF16,0x3F}, {0xFF17,0x00},
+        {0xFF19,0xBF}, {0xFF1A,0x7F}, {0xFF1B,0xFF}, {0xFF1C,0x9F}, {0xFF1E,0xBF}, {0xFF20,0xFF},
+        {0xFF21,0x00}, {0xFF22,0x00}, {0xFF23,0xBF}, {0xFF24,0x77}, {0xFF25,0xF3}, {0xFF26,0xF1}
+    }};
+    for(const auto& [adr, val]: post_boot_io)
+        io_regs[adr-0xFF00] = val;
+    io_regs[0x50] = 0x01;
+    ie = 0x00;
+    update_pending_interrupts();
+    gb->timer.apply_post_boot_state();
+    //  the logo from the header, every bit doubled horizontally and vertically, followed by the (R) tile.
+    static constexpr std::array<uint8_t,8> registered_tile{0x3C,0x42,0xB9,0xA5,0xB9,0xA5,0x42,0x3C};
+    uint16_t adr = 0x8010;
+    for(uint16_t logo = 0x0104; logo < 0x0134; ++logo){
+        const uint8_t byte = mbc->read_rom(logo);
+        for(uint8_t nibble: {(uint8_t)(byte>>4), (uint8_t)(byte&0x0F)}){
+            uint8_t doubled = 0;
+            for(size_t bit = 0; bit < 4; ++bit)
+                doubled |= ((nibble>>bit)&1)*(0b11<<(bit*2));
+            mbc->write_vram(adr-0x8000, doubled);
+            mbc->write_vram(adr+2-0x8000, doubled);
+            adr += 4;
+        }
+    }
+    for(uint8_t row: registered_tile){
+        mbc->write_vram(adr-0x8000, row);
+        adr += 2;
+    }
+    //  the tile map, two rows of 12 logo tiles and the (R) at the end of the top one.
+    mbc->write_vram(0x9910-0x8000, 0x19);
+    for(uint8_t tile = 0x01; tile <= 0x0C; ++tile){
+        mbc->write_vram(0x9903+tile-0x8000, tile);
+        mbc->write_vram(0x9923+tile-0x8000, tile+0x0C);
+    }
+    gb->ppu.apply_post_boot_state();
+    remap();
+}
+void memory_t::start_oam_dma(uint8_t page){
+    oam_dma_page = page;
+    oam_dma_active = true;
+    //  every access goes through the slow path, which blocks all but io and hram.
+    read_pages.fill(nullptr);
+    write_pages.fill(nullptr);
+    gb->scheduler.add_event(OAM_DMA_CYCLES, scheduler_event::OAM_DMA);
+}
+
+//  the source can't change while the cpu is locked out, so it's copied in one go once the transfer is over.
+void memory_t::finish_oam_dma(){
+    oam_dma_active = false;
+    remap();
+    gb->ppu.sync();
+    //  sources past 0xDFFF read the wram echo.
+    const uint8_t page = oam_dma_page >= 0xE0 ? oam_dma_page-0x20 : oam_dma_page;
+    read_block(page<<8, oam.data(), oam.size());
+    gb->ppu.on_oam_dma();
+}
+
+void memory_t::write_hdma(uint16_t adr, uint8_t val){
+    switch(adr){
+    case 0xFF51: hdma_src = (hdma_src&0x00FF)|val<<8;           break;
+    case 0xFF52: hdma_src = (hdma_src&0xFF00)|(val&0xF0);       break;
+    case 0xFF53: hdma_dst = (hdma_dst&0x00FF)|(val&0x1F)<<8;    break;
+    case 0xFF54: hdma_dst = (hdma_dst&0xFF00)|(val&0xF0);       break;
+    case 0xFF55:
+        //  clearing bit 7 stops a running hblank dma, the length left stays readable.
+        if(hdma_active && !(val&0x80)){
+            hdma_active = false;
+            hdma_status |= 0x80;
+            break;
+        }
+        hdma_status = val&0x7F;
+        if(val&0x80){
+            hdma_active = true;
+            break;
+        }
+        //  general purpose dma moves everything at once, with the cpu stalled meanwhile.
+        for(size_t blocks = hdma_status+1; blocks > 0; --blocks)
+            copy_hdma_block();
+        gb->scheduler.tick_system((hdma_status+1)*HDMA_BLOCK_CYCLES);
+        hdma_status = 0xFF;
+    }
+}
+
+void memory_t::on_hblank(){
+    if(!hdma_active)
+        return;
+    copy_hdma_block();
+    gb->scheduler.tick_system(HDMA_BLOCK_CYCLES);
+    if(hdma_status-- == 0){
+        hdma_active = false;
+        hdma_status = 0xFF;
+    }
+}
+
+void memory_t::copy_hdma_block(){
+    const uint16_t dst = 0x8000|hdma_dst;
+    std::array<uint8_t,16> block;
+    read_block(hdma_src, block.data(), block.size());
+    gb->ppu.on_vram_write(dst);
+    gb->blocks.invalidate(*this, dst, dst+0x0F);
+    std::copy(block.begin(), block.end(), mbc->get_page(dst));
+    hdma_src += 0x10;
+    hdma_dst = (hdma_dst+0x10)&0x1FF0;
+}
+
+void memory_t::read_block(uint16_t src, uint8_t* out, size_t len){
+    if(const uint8_t* page = read_pages[src>>8])
+        std::copy_n(&page[src&0xFF], len, out);
+    else{
+        for(size_t i = 0; i < len; ++i)
+            out[i] = debug_read(src+i);
+    }
+}
+
+void memory_t::remap(size_t first_page, size_t last_page){
+    if(oam_dma_active)
+        return;
+    for(size_t page = first_page; page <= last_page; ++page){
+        const uint16_t adr = page<<8;
+        uint8_t* p = nullptr;
+        switch(adr){
+        case 0x0000 ... 0x7FFF:
+            read_pages[page] = mbc->get_rom_page(adr);
+            write_pages[page] = nullptr;
+            continue;
+        case 0x8000 ... 0xBFFF: p = mbc->get_page(adr);         break;
+        case 0xC000 ... 0xCFFF: p = &wram[adr-0xC000];          break;
+        case 0xD000 ... 0xDFFF: p = mbc->get_page(adr);         break;
+        case 0xE000 ... 0xEFFF: p = &wram[adr-0xE000];          break;
+        case 0xF000 ... 0xFDFF: p = mbc->get_page(adr-0x2000);  break;
+        }
+        read_pages[page] = p;
+        //  vram writes go through the slow path too, the fifo has to catch up first and tile data invalidates the decoded tile.
+        const bool vram = adr >= 0x8000 && adr < 0xA000;
+        write_pages[page] = vram || gb->blocks.is_code_page(adr) ? nullptr : p;
+    }
+    //  reading 0x0100 is what unmaps the boot rom.
+    if(boot_rom_bound)
+        read_pages[0x01] = nullptr;
 }
 
 void memory_t::bind_boot_rom(){
     boot_rom_bound = true;
     mbc->strap_boot_rom();
+    remap();
 }
 
 void memory_t::unbind_boot_rom(){
     if(boot_rom_bound)
         mbc->unstrap_boot_rom();
     boot_rom_bound = false;
-#ifdef __DEBUG__
+    gb->blocks.clear();
+    remap();
     if(dbg_unbind_bootrom_callbk)
         dbg_unbind_bootrom_callbk();
-#endif
 }
 
 void memory_t::allocate_mbc_type(uint8_t mbc_type){
     switch(mbc_type){
-    case 0x00:
-        mbc = std::make_unique<mbc_none_t>();
+    case 0x00: case 0x08: case 0x09:
+        mbc = std::make_unique<mbc_t>(mbc_none_t{});
+        return;
+    case 0x01 ... 0x03:
+        mbc = std::make_unique<mbc_t>(mbc1_t{});
+        break;
+    case 0x0F ... 0x13:
+        mbc = std::make_unique<mbc_t>(mbc3_t{});
         break;
-    case 0x01:
-        mbc = std::make_unique<mbc1_t>();
+    case 0x19 ... 0x1E:
+        mbc = std::make_unique<mbc_t>(mbc5_t{});
         break;
+    default:
+        throw std::runtime_error("unsupported cartridge type");
     }
+    //  controllers keep cart ram disabled until the game enables it.
+    mbc->enable_ram(false);
 }
 
-void mbc_t::load_rom(const std::vector<char>& rom_data){
-    std::copy(&rom_data[0x0134], &rom_data[0x014F], reinterpret_cast<uint8_t*>(&info));
-    std::copy(rom_data.begin(), rom_data.begin()+rom1.size(), rom1.data());
-    std::vector<rom_bank_t> banks_vec;
-    banks_vec.reserve((2<<info.rom_size)-1);
-    auto iter = rom_data.begin()+rom1.size();
-    for(rom_bank_t bank; iter<rom_data.end(); banks_vec.push_back(bank),bank={},iter+=bank.size())
-        std::copy(iter, iter+bank.size(), bank.data());
-    rom2.copy_from_vec(banks_vec);
+void mbc_t::load_rom(std::shared_ptr<const rom_image_t> image){
+    static constexpr std::array<size_t,6> ram_bank_counts{0, 1, 1, 4, 16, 8};
+    std::copy(&image->data()[0x0134], &image->data()[0x014F], reinterpret_cast<uint8_t*>(&info));
+    rom = std::move(image);
+    select_rom_bank(1);
+    ram_banks.alloc(std::max<size_t>(1, info.ram_size < ram_bank_counts.size() ? ram_bank_counts[info.ram_size] : 1));
 }
 
 void mbc_t::strap_boot_rom(){
-    std::copy(rom1.begin(), rom1.end(), unbinded_rom.begin());
-    std::ifstream boot_rom_stream{"roms/dmg_boot.bin", std::ios::binary};
-    if(!boot_rom_stream)
-        throw std::runtime_error("unable to locate boot rom file!");
-    boot_rom_stream.read(reinterpret_cast<char*>(rom1.data()),256);
+    //  read once per process, a failed read throws and is retried on the next load.
+    static const std::array<uint8_t,0x100> image = [](){
+        std::array<uint8_t,0x100> image{0};
+        std::ifstream boot_rom_stream{"roms/dmg_boot.bin", std::ios::binary};
+        if(!boot_rom_stream)
+            throw std::runtime_error("unable to locate boot rom file!");
+        boot_rom_stream.read(reinterpret_cast<char*>(image.data()),image.size());
+        return image;
+    }();
+    boot_rom = &image;
 }
 
 void mbc_t::unstrap_boot_rom(){
-    std::copy(unbinded_rom.begin(), unbinded_rom.end(), rom1.begin());
+    boot_rom = nullptr;
 }
 
-uint8_t mbc_t::read_rom(uint16_t adr){
+uint8_t* mbc_t::get_page(uint16_t adr){
+    switch(adr){
+    case 0x8000 ... 0x9FFF: return &vram_banks.get()[adr-0x8000];
+    case 0xA000 ... 0xBFFF: return ram_enabled && !mapped_register ? &ram_banks.get()[adr-0xA000] : nullptr;
+    case 0xD000 ... 0xDFFF: return &wram_banks.get()[adr-0xD000];
+    }
+    return nullptr;
+}
+
+const uint8_t* mbc_t::get_rom_page(uint16_t adr){
+    if(boot_rom && adr < boot_rom->size())
+        return &(*boot_rom)[adr];
     if(adr < 0x4000)
-        return rom1[adr];
-    return rom2.get()[adr-0x4000];
+        return &rom->get_bank(0)[adr];
+    return &rom->get_bank(rom_bank)[adr-0x4000];
+}
+
+uint8_t mbc_t::read_rom(uint16_t adr){
+    return *get_rom_page(adr);
 }
 
 uint8_t mbc_t::read_ram(uint16_t adr){
+    if(mapped_register)
+        return *mapped_register;
+    if(!ram_enabled)
+        return 0xFF;
     return ram_banks.get()[adr];
 }
 
@@ -214,7 +418,10 @@ uint8_t mbc_t::read_vram(uint16_t adr){
 }
 
 void mbc_t::write_ram(uint16_t adr, uint8_t val){
-    ram_banks.get()[adr] = val;
+    if(mapped_register)
+        *mapped_register = val;
+    else if(ram_enabled)
+        ram_banks.get()[adr] = val;
 }
 
 void mbc_t::write_wram(uint16_t adr, uint8_t val){
@@ -225,25 +432,62 @@ void mbc_t::write_vram(uint16_t adr, uint8_t val){
     vram_banks.get()[adr] = val;
 }
 
-void mbc_none_t::rom_write(uint16_t adr, uint8_t val){
-    return;
+void mbc1_t::rom_write(mbc_t& mbc, uint16_t adr, uint8_t val){
+    switch(adr){
+    case 0x0000 ... 0x1FFF:
+        mbc.enable_ram((val&0x0F) == 0x0A);
+        return;
+    case 0x2000 ... 0x3FFF:
+        rom_bank = val&0x1F ? val&0x1F : 1;
+        break;
+    case 0x4000 ... 0x5FFF:
+        secondary_bank_index = val&0b11;
+        break;
+    case 0x6000 ... 0x7FFF:
+        ram_mode = val&1;
+    }
+    //  the secondary register extends the rom bank on large carts, and picks the ram bank in ram mode.
+    mbc.select_rom_bank(secondary_bank_index<<5 | rom_bank);
+    mbc.select_ram_bank(ram_mode ? secondary_bank_index : 0);
 }
 
-void mbc1_t::rom_write(uint16_t adr, uint8_t val){
+void mbc3_t::rom_write(mbc_t& mbc, uint16_t adr, uint8_t val){
     switch(adr){
     case 0x0000 ... 0x1FFF:
-        ram_enabled = val == 0x0A;
+        mbc.enable_ram((val&0x0F) == 0x0A);
         break;
     case 0x2000 ... 0x3FFF:
-        rom2.set_active((val&0x1F) + (rom2.get_size() > 0x1F)*secondary_bank_index);
+        mbc.select_rom_bank(val&0x7F ? val&0x7F : 1);
         break;
     case 0x4000 ... 0x5FFF:
-        if(ram_mode)
-            ram_banks.set_active(val&0b11);
-        else
-            secondary_bank_index = val&0b11;
+        if(val >= 0x08 && val <= 0x0C){
+            mbc.map_register(&rtc[val-0x08]);
+        } else{
+            mbc.map_register(nullptr);
+            mbc.select_ram_bank(val&0b11);
+        }
         break;
     case 0x6000 ... 0x7FFF:
-        ram_mode = val == 1;
+        //  the clock isn't running, so latching has nothing to capture.
+        break;
+    }
+}
+
+void mbc5_t::rom_write(mbc_t& mbc, uint16_t adr, uint8_t val){
+    switch(adr){
+    case 0x0000 ... 0x1FFF:
+        mbc.enable_ram((val&0x0F) == 0x0A);
+        break;
+    case 0x2000 ... 0x2FFF:
+        rom_bank = (rom_bank&0x100) | val;
+        mbc.select_rom_bank(rom_bank);
+        break;
+    case 0x3000 ... 0x3FFF:
+        rom_bank = (rom_bank&0xFF) | (val&1)<<8;
+        mbc.select_rom_bank(rom_bank);
+        break;
+    case 0x4000 ... 0x5FFF:
+        mbc.select_ram_bank(val&0x0F);
+        break;
     }
 }
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include<memory/rom_image.h>
+#include<unordered_map>
+#include<filesystem>
+#include<fstream>
+#include<mutex>
+#include<stdexcept>
+#if defined(__unix__)
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<fcntl.h>
+#include<unistd.h>
+#endif
+
+//  weak, an image is unmapped as soon as the last instance using it lets go.
+static std::mutex images_mutex;
+static std::unordered_map<std::string, std::weak_ptr<const rom_image_t>> images;
+
+std::shared_ptr<const rom_image_t> rom_image_t::open(const std::string& path){
+    std::error_code error;
+    const std::string key = std::filesystem::canonical(path, error).string();
+    if(error)
+        throw std::runtime_error("unable to locate rom");
+    std::lock_guard lock{images_mutex};
+    if(auto image = images[key].lock())
+        return image;
+    std::shared_ptr<rom_image_t> image{new rom_image_t};
+#if defined(__unix__)
+    int fd = ::open(key.c_str(), O_RDONLY);
+    struct stat st;
+    if(fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0 && st.st_size%sizeof(rom_bank_t) == 0){
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p != MAP_FAILED){
+            image->base = static_cast<const uint8_t*>(p);
+            image->length = image->mapped_length = st.st_size;
+        }
+    }
+    if(fd >= 0)
+        close(fd);
+#endif
+    if(!image->base){
+        std::ifstream stream{key, std::ios::binary|std::ios::ate};
+        if(!stream)
+            throw std::runtime_error("unable to locate rom");
+        const size_t size = stream.tellg();
+        //  at least the two banks the cpu always sees.
+        image->owned.resize(std::max((size+sizeof(rom_bank_t)-1)/sizeof(rom_bank_t), size_t{2})*sizeof(rom_bank_t));
+        stream.seekg(std::ios::beg);
+        stream.read(reinterpret_cast<char*>(image->owned.data()), size);
+        image->base = image->owned.data();
+        image->length = image->owned.size();
+    }
+    images[key] = image;
+    return image;
+}
+
+rom_image_t::~rom_image_t(){
+#if defined(__unix__)
+    if(mapped_length)
+        munmap(const_cast<uint8_t*>(base), mapped_length);
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#include<memory/watchpoints.h>
+#include<algorithm>
+
+void watchpoints_t::add(uint16_t from, uint16_t to){
+    if(from > to)
+        std::swap(from, to);
+    ranges.push_back({from, to});
+    for(uint32_t adr = from; adr <= to; ++adr)
+        bits[adr>>6] |= 1ull<<(adr&0x3F);
+    armed = true;
+}
+
+void watchpoints_t::remove(uint16_t adr){
+    std::erase_if(ranges, [adr](const auto& range){ return range.first <= adr && adr <= range.second; });
+    rebuild();
+}
+
+void watchpoints_t::clear(){
+    ranges.clear();
+    rebuild();
+}
+
+//  ranges may overlap, so the bitmap is built again from the remaining ones.
+void watchpoints_t::rebuild(){
+    bits.fill(0);
+    for(const auto& [from, to]: ranges){
+        for(uint32_t adr = from; adr <= to; ++adr)
+            bits[adr>>6] |= 1ull<<(adr&0x3F);
+    }
+    armed = !ranges.empty();
+}
\ No newline at end of file
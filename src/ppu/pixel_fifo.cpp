@@ -0,0 +1,109 @@
+#include<ppu/pixel_fifo.h>
+#include<ppu/ppu.h>
+#include<gameboy.h>
+
+void pixel_fifo_t::start_line(ppu_t& ppu){
+    const auto& line = ppu.select_sprites();
+    line_sprites = line.sprites;
+    sprite_count = line.count;
+    next_sprite = 0;
+    sprites.fill({0, 0});
+    bg_head = 8;
+    dots = fetch_dots = fetch_x = lx = 0;
+    //  the first fetch of every line is thrown away.
+    stall = FETCH_DOTS;
+    discard = ppu.scx&7;
+    window = false;
+}
+
+void pixel_fifo_t::run(ppu_t& ppu, size_t n){
+    const uint8_t* oam = ppu.gb->mem.get_oam();
+    for(; n && !is_done(); --n, ++dots){
+        if(stall){
+            --stall;
+            continue;
+        }
+        //  reaching wx restarts the fetcher on the window map.
+        if(!window && (ppu.lcdc&0x20) && ppu.wy <= ppu.ly && ppu.wx < 167 && lx+7 >= ppu.wx){
+            window = true;
+            fetch_x = 0;
+            fetch_dots = 0;
+            bg_head = 8;
+            //  below 7 the window starts left of the screen, its first 7-wx pixels are never shown.
+            discard = ppu.wx < 7 ? 7-ppu.wx : 0;
+        }
+        if(next_sprite < sprite_count && (ppu.lcdc&0x02) && oam[line_sprites[next_sprite]*4+1] <= lx+8){
+            fetch_sprite(ppu, &oam[line_sprites[next_sprite++]*4]);
+            stall = SPRITE_DOTS-1;
+            continue;
+        }
+        if(fetch_dots >= FETCH_DOTS && bg_head == 8){
+            fetch_tile(ppu);
+            fetch_dots = 0;
+        }
+        ++fetch_dots;
+        if(bg_head < 8)
+            push_pixel(ppu);
+    }
+}
+
+void pixel_fifo_t::fetch_tile(ppu_t& ppu){
+    const uint8_t* vram = ppu.gb->mem.get_vram();
+    uint8_t id, row;
+    if(window){
+        id = vram[(ppu.lcdc&0x40 ? 0x1C00 : 0x1800)+(ppu.window_line>>3)*32+fetch_x];
+        row = ppu.window_line&7;
+    } else{
+        //  scx and scy are read again on every fetch, so changing them mid line takes effect.
+        const uint8_t y = ppu.scy+ppu.ly;
+        id = vram[(ppu.lcdc&0x08 ? 0x1C00 : 0x1800)+(y>>3)*32+((ppu.scx>>3)+fetch_x)%32];
+        row = y&7;
+    }
+    fetch_x = (fetch_x+1)%32;
+    if(ppu.lcdc&0x01){
+        const auto& tile = ppu.tiles.get(vram, ppu.get_tile_index(id));
+        std::copy_n(&tile[row*8], 8, bg.begin());
+    } else
+        bg.fill(0);
+    bg_head = 0;
+}
+
+void pixel_fifo_t::fetch_sprite(ppu_t& ppu, const uint8_t* sprite){
+    const int height = ppu.lcdc&0x04 ? 16 : 8;
+    const uint8_t attr = sprite[3];
+    int y = ppu.ly+16-sprite[0];
+    if(attr&0x40)
+        y = height-1-y;
+    const uint8_t id = height == 16 ? sprite[2]&0xFE : sprite[2];
+    const auto& tile = ppu.tiles.get(ppu.gb->mem.get_vram(), id+(y>>3));
+    for(int i = 0; i < 8; ++i){
+        const int x = sprite[1]-8+i;
+        if(x < lx)
+            continue;
+        //  sprites fetched earlier keep their opaque pixels.
+        auto& slot = sprites[x-lx];
+        const uint8_t color = tile[(y&7)*8+(attr&0x20 ? 7-i : i)];
+        if(!slot.color && color)
+            slot = {color, attr};
+    }
+}
+
+void pixel_fifo_t::push_pixel(ppu_t& ppu){
+    const uint8_t color = bg[bg_head++];
+    if(discard){
+        --discard;
+        return;
+    }
+    const sprite_pixel_t sprite = sprites[0];
+    std::copy(sprites.begin()+1, sprites.end(), sprites.begin());
+    sprites.back() = {0, 0};
+    //  palettes are read per pixel as well.
+    uint32_t rgba;
+    if(sprite.color && (ppu.lcdc&0x02) && !((sprite.attr&0x80) && color))
+        rgba = ppu.SHADES[((sprite.attr&0x10 ? ppu.obp1 : ppu.obp0)>>(sprite.color*2))&0b11];
+    else
+        rgba = ppu.SHADES[(ppu.bgp>>(color*2))&0b11];
+    ppu.framebuffer[ppu.ly*ppu.WIDTH+lx++] = rgba;
+    if(is_done() && window)
+        ++ppu.window_line;
+}
\ No newline at end of file
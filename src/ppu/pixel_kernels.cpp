@@ -0,0 +1,136 @@
+#include<ppu/pixel_kernels.h>
+#if defined(__x86_64__)
+#include<immintrin.h>
+#endif
+
+namespace{
+    void decode_tile_scalar(const uint8_t* data, uint8_t* out){
+        for(size_t row = 0; row < 8; ++row){
+            const uint8_t lo = data[row*2], hi = data[row*2+1];
+            for(size_t x = 0; x < 8; ++x)
+                out[row*8+x] = ((lo>>(7-x))&1) | (((hi>>(7-x))&1)<<1);
+        }
+    }
+
+    void expand_scalar(const uint8_t* indices, const uint32_t* palette, uint32_t* out, size_t count){
+        for(size_t i = 0; i < count; ++i)
+            out[i] = palette[indices[i]&0b11];
+    }
+
+#if defined(__x86_64__)
+    //  takes [lo x8, hi x8] for a row, leaves its 8 indices in the low half.
+    __attribute__((target("sse2"))) __m128i decode_row_sse2(__m128i planes){
+        const __m128i bits = _mm_set_epi8(1,2,4,8,16,32,64,(char)128, 1,2,4,8,16,32,64,(char)128);
+        const __m128i weights = _mm_set_epi8(2,2,2,2,2,2,2,2, 1,1,1,1,1,1,1,1);
+        const __m128i set = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(planes, bits), bits), weights);
+        return _mm_add_epi8(set, _mm_srli_si128(set, 8));
+    }
+
+    __attribute__((target("sse2"))) void decode_tile_sse2(const uint8_t* data, uint8_t* out){
+        const __m128i tile = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        //  every byte repeated 8 times, grouped as the two bitplanes of one row.
+        const __m128i halves[2] = {_mm_unpacklo_epi8(tile, tile), _mm_unpackhi_epi8(tile, tile)};
+        for(__m128i pairs: halves){
+            const __m128i rows[2] = {_mm_unpacklo_epi16(pairs, pairs), _mm_unpackhi_epi16(pairs, pairs)};
+            for(__m128i quads: rows){
+                const __m128i first = decode_row_sse2(_mm_unpacklo_epi32(quads, quads));
+                const __m128i second = decode_row_sse2(_mm_unpackhi_epi32(quads, quads));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi64(first, second));
+                out += 16;
+            }
+        }
+    }
+
+    //  starts from color 0 and xors in the difference to the color each mask selects.
+    __attribute__((target("sse2"))) __m128i select_sse2(__m128i base, const __m128i* deltas, __m128i is1, __m128i is2, __m128i is3){
+        return _mm_xor_si128(_mm_xor_si128(base, _mm_and_si128(is1, deltas[0])),
+            _mm_xor_si128(_mm_and_si128(is2, deltas[1]), _mm_and_si128(is3, deltas[2])));
+    }
+
+    __attribute__((target("sse2"))) void expand_sse2(const uint8_t* indices, const uint32_t* palette, uint32_t* out, size_t count){
+        const __m128i base = _mm_set1_epi32(palette[0]);
+        const __m128i deltas[3] = {
+            _mm_set1_epi32(palette[0]^palette[1]), _mm_set1_epi32(palette[0]^palette[2]), _mm_set1_epi32(palette[0]^palette[3])
+        };
+        size_t i = 0;
+        for(; i+16 <= count; i += 16){
+            const __m128i idx = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&indices[i])), _mm_set1_epi8(0b11));
+            const __m128i is1 = _mm_cmpeq_epi8(idx, _mm_set1_epi8(1));
+            const __m128i is2 = _mm_cmpeq_epi8(idx, _mm_set1_epi8(2));
+            const __m128i is3 = _mm_cmpeq_epi8(idx, _mm_set1_epi8(3));
+            //  the byte masks widened to 32 bits, pixels 0-7 and 8-15 first.
+            const __m128i lo1 = _mm_unpacklo_epi8(is1, is1), hi1 = _mm_unpackhi_epi8(is1, is1);
+            const __m128i lo2 = _mm_unpacklo_epi8(is2, is2), hi2 = _mm_unpackhi_epi8(is2, is2);
+            const __m128i lo3 = _mm_unpacklo_epi8(is3, is3), hi3 = _mm_unpackhi_epi8(is3, is3);
+            __m128i* dest = reinterpret_cast<__m128i*>(&out[i]);
+            _mm_storeu_si128(dest, select_sse2(base, deltas,
+                _mm_unpacklo_epi16(lo1, lo1), _mm_unpacklo_epi16(lo2, lo2), _mm_unpacklo_epi16(lo3, lo3)));
+            _mm_storeu_si128(dest+1, select_sse2(base, deltas,
+                _mm_unpackhi_epi16(lo1, lo1), _mm_unpackhi_epi16(lo2, lo2), _mm_unpackhi_epi16(lo3, lo3)));
+            _mm_storeu_si128(dest+2, select_sse2(base, deltas,
+                _mm_unpacklo_epi16(hi1, hi1), _mm_unpacklo_epi16(hi2, hi2), _mm_unpacklo_epi16(hi3, hi3)));
+            _mm_storeu_si128(dest+3, select_sse2(base, deltas,
+                _mm_unpackhi_epi16(hi1, hi1), _mm_unpackhi_epi16(hi2, hi2), _mm_unpackhi_epi16(hi3, hi3)));
+        }
+        expand_scalar(&indices[i], palette, &out[i], count-i);
+    }
+
+    __attribute__((target("avx2"))) __m256i decode_rows_avx2(__m256i planes){
+        const __m256i bits = _mm256_set_epi8(
+            1,2,4,8,16,32,64,(char)128, 1,2,4,8,16,32,64,(char)128,
+            1,2,4,8,16,32,64,(char)128, 1,2,4,8,16,32,64,(char)128);
+        const __m256i weights = _mm256_set_epi8(
+            2,2,2,2,2,2,2,2, 1,1,1,1,1,1,1,1,
+            2,2,2,2,2,2,2,2, 1,1,1,1,1,1,1,1);
+        const __m256i set = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(planes, bits), bits), weights);
+        return _mm256_add_epi8(set, _mm256_srli_si256(set, 8));
+    }
+
+    __attribute__((target("avx2"))) void decode_tile_avx2(const uint8_t* data, uint8_t* out){
+        const __m128i tile = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        //  four rows at a time, rows n and n+2 sharing an instruction in the two lanes.
+        const __m128i halves[2] = {_mm_unpacklo_epi8(tile, tile), _mm_unpackhi_epi8(tile, tile)};
+        for(__m128i pairs: halves){
+            const __m256i quads = _mm256_set_m128i(_mm_unpackhi_epi16(pairs, pairs), _mm_unpacklo_epi16(pairs, pairs));
+            const __m256i even = decode_rows_avx2(_mm256_unpacklo_epi32(quads, quads));
+            const __m256i odd = decode_rows_avx2(_mm256_unpackhi_epi32(quads, quads));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_unpacklo_epi64(even, odd));
+            out += 32;
+        }
+    }
+
+    __attribute__((target("avx2"))) void expand_avx2(const uint8_t* indices, const uint32_t* palette, uint32_t* out, size_t count){
+        //  the palette twice over, so the permute can use the index as is.
+        const __m128i colors = _mm_loadu_si128(reinterpret_cast<const __m128i*>(palette));
+        const __m256i table = _mm256_set_m128i(colors, colors);
+        const __m256i mask = _mm256_set1_epi32(0b11);
+        size_t i = 0;
+        for(; i+8 <= count; i += 8){
+            const __m256i idx = _mm256_and_si256(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&indices[i]))), mask);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&out[i]), _mm256_permutevar8x32_epi32(table, idx));
+        }
+        expand_scalar(&indices[i], palette, &out[i], count-i);
+    }
+#endif
+
+    constexpr pixel_kernels_t scalar_kernels{decode_tile_scalar, expand_scalar, pixel_isa::SCALAR};
+#if defined(__x86_64__)
+    constexpr pixel_kernels_t sse2_kernels{decode_tile_sse2, expand_sse2, pixel_isa::SSE2};
+    constexpr pixel_kernels_t avx2_kernels{decode_tile_avx2, expand_avx2, pixel_isa::AVX2};
+#endif
+}
+
+const pixel_kernels_t& pixel_kernels_t::get(){
+    static const pixel_kernels_t& kernels = get(pixel_isa::AVX2);
+    return kernels;
+}
+
+const pixel_kernels_t& pixel_kernels_t::get(pixel_isa isa){
+#if defined(__x86_64__)
+    if(isa == pixel_isa::AVX2 && __builtin_cpu_supports("avx2"))
+        return avx2_kernels;
+    if(isa != pixel_isa::SCALAR && __builtin_cpu_supports("sse2"))
+        return sse2_kernels;
+#endif
+    return scalar_kernels;
+}
\ No newline at end of file
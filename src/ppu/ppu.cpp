@@ -0,0 +1,235 @@
+#include<ppu/ppu.h>
+#include<gameboy.h>
+#include<algorithm>
+
+void ppu_t::update(){
+    switch(mode){
+    case ppu_mode::OAM_SCAN:
+        transfer_stamp = mode_stamp;
+        fifo_line = engine == ppu_engine::FIFO;
+        if(fifo_line)
+            fifo.start_line(*this);
+        enter_mode(ppu_mode::TRANSFER, TRANSFER_CYCLES);
+        break;
+    case ppu_mode::TRANSFER:{
+        size_t transfer_cycles = TRANSFER_CYCLES;
+        if(fifo_line){
+            sync();
+            //  sprites and the window stretch mode 3, look again once the rest of the line could be out.
+            if(!fifo.is_done()){
+                mode_stamp += fifo.get_min_remaining();
+                gb->scheduler.add_event(mode_stamp-std::min(mode_stamp, gb->scheduler.get_cycles()), scheduler_event::PPU);
+                return;
+            }
+            transfer_cycles = fifo.get_dots();
+            mode_stamp = transfer_stamp+transfer_cycles;
+        } else
+            render_scanline();
+        enter_mode(ppu_mode::HBLANK, LINE_CYCLES-OAM_SCAN_CYCLES-transfer_cycles);
+        gb->mem.on_hblank();
+        break;
+    }
+    case ppu_mode::HBLANK:
+        if(++ly < HEIGHT)
+            return start_line();
+        ++frame_count;
+        window_line = 0;
+        gb->mem.request_interrupt(interrupt_bit::VBLANK);
+        enter_mode(ppu_mode::VBLANK, LINE_CYCLES);
+        break;
+    case ppu_mode::VBLANK:
+        if(++ly < LINE_COUNT)
+            return enter_mode(ppu_mode::VBLANK, LINE_CYCLES);
+        ly = 0;
+        start_line();
+    }
+}
+
+void ppu_t::start_line(){
+    enter_mode(ppu_mode::OAM_SCAN, OAM_SCAN_CYCLES);
+}
+
+void ppu_t::enter_mode(ppu_mode mode, size_t cycles){
+    this->mode = mode;
+    update_stat_line();
+    //  events run at the end of an instruction, so the next one counts from the deadline rather than from now.
+    const uint64_t now = gb->scheduler.get_cycles();
+    mode_stamp += cycles;
+    gb->scheduler.add_event(mode_stamp > now ? mode_stamp-now : 0, scheduler_event::PPU);
+}
+
+void ppu_t::update_stat_line(){
+    const bool line = is_enabled() && (
+        ((stat&0x40) && ly == lyc) ||
+        ((stat&0x08) && mode == ppu_mode::HBLANK) ||
+        ((stat&0x10) && mode == ppu_mode::VBLANK) ||
+        ((stat&0x20) && mode == ppu_mode::OAM_SCAN));
+    if(line && !stat_line)
+        gb->mem.request_interrupt(interrupt_bit::LCD_STAT);
+    stat_line = line;
+}
+
+void ppu_t::sync(){
+    if(!fifo_line || mode != ppu_mode::TRANSFER)
+        return;
+    const size_t elapsed = gb->scheduler.get_cycles()-transfer_stamp;
+    if(elapsed > fifo.get_dots())
+        fifo.run(*this, elapsed-fifo.get_dots());
+}
+
+uint8_t ppu_t::read(uint16_t adr){
+    switch(adr){
+    case 0xFF40: return lcdc;
+    case 0xFF41: return 0x80|stat|(ly == lyc)<<2|(is_enabled() ? (uint8_t)mode : 0);
+    case 0xFF42: return scy;
+    case 0xFF43: return scx;
+    case 0xFF44: return ly;
+    case 0xFF45: return lyc;
+    case 0xFF47: return bgp;
+    case 0xFF48: return obp0;
+    case 0xFF49: return obp1;
+    case 0xFF4A: return wy;
+    }
+    return wx;
+}
+
+void ppu_t::write(uint16_t adr, uint8_t val){
+    sync();
+    switch(adr){
+    case 0xFF40:{
+        const bool was_enabled = is_enabled();
+        if((lcdc^val)&0x04)
+            sprite_index.rebuild(gb->mem.get_oam(), val&0x04 ? 16 : 8);
+        lcdc = val;
+        if(was_enabled == is_enabled())
+            break;
+        //  switched off the lcd sits at line 0 in mode 0, switched on it starts over from there.
+        ly = 0;
+        window_line = 0;
+        mode = ppu_mode::HBLANK;
+        if(is_enabled()){
+            mode_stamp = gb->scheduler.get_cycles();
+            start_line();
+        } else{
+            gb->scheduler.cancel(scheduler_event::PPU);
+            stat_line = false;
+        }
+        break;
+    }
+    case 0xFF41:
+        stat = val&0x78;
+        update_stat_line();
+        break;
+    case 0xFF42: scy = val;     break;
+    case 0xFF43: scx = val;     break;
+    case 0xFF44:                break;  //  read only.
+    case 0xFF45:
+        lyc = val;
+        update_stat_line();
+        break;
+    case 0xFF47: bgp = val;     break;
+    case 0xFF48: obp0 = val;    break;
+    case 0xFF49: obp1 = val;    break;
+    case 0xFF4A: wy = val;      break;
+    case 0xFF4B: wx = val;      break;
+    }
+}
+
+void ppu_t::apply_post_boot_state(){
+    lcdc = 0x91;
+    stat = scy = scx = lyc = wy = wx = 0;
+    bgp = 0xFC;
+    obp0 = obp1 = 0xFF;
+    ly = window_line = 0;
+    stat_line = false;
+    //  the boot rom drew the logo without going through the cache.
+    tiles.invalidate_all();
+    sprite_index.rebuild(gb->mem.get_oam(), 8);
+    mode_stamp = gb->scheduler.get_cycles();
+    start_line();
+}
+
+void ppu_t::render_scanline(){
+    std::array<uint8_t,WIDTH> color{0};
+    if(lcdc&0x01){
+        render_background(color.data());
+        if((lcdc&0x20) && wy <= ly && wx < WIDTH+7)
+            render_window(color.data());
+    }
+    uint32_t* line = &framebuffer[ly*WIDTH];
+    kernels->expand(color.data(), get_palette(bgp).data(), line, WIDTH);
+    if(lcdc&0x02)
+        render_sprites(line, color.data());
+}
+
+void ppu_t::render_background(uint8_t* color){
+    const uint8_t* vram = gb->mem.get_vram();
+    const uint8_t y = scy+ly;
+    const uint8_t* map = &vram[(lcdc&0x08 ? 0x1C00 : 0x1800)+(y>>3)*32];
+    const size_t row = (y&7)*8;
+    for(size_t x = 0; x < WIDTH;){
+        const uint8_t px = scx+x;
+        const auto& tile = tiles.get(vram, get_tile_index(map[px>>3]));
+        //  the first tile may be entered partway through its row.
+        for(size_t i = px&7; i < 8 && x < WIDTH; ++i)
+            color[x++] = tile[row+i];
+    }
+}
+
+void ppu_t::render_window(uint8_t* color){
+    const uint8_t* vram = gb->mem.get_vram();
+    const uint8_t* map = &vram[(lcdc&0x40 ? 0x1C00 : 0x1800)+(window_line>>3)*32];
+    const size_t row = (window_line&7)*8;
+    const int start = wx-7;
+    for(size_t x = std::max(start, 0); x < WIDTH; ++x){
+        const size_t px = x-start;
+        color[x] = tiles.get(vram, get_tile_index(map[px>>3]))[row+(px&7)];
+    }
+    ++window_line;
+}
+
+void ppu_t::render_sprites(uint32_t* line, const uint8_t* color){
+    const uint8_t* vram = gb->mem.get_vram();
+    const uint8_t* oam = gb->mem.get_oam();
+    const int height = lcdc&0x04 ? 16 : 8;
+    const auto& [visible, count] = select_sprites();
+    //  the highest priority opaque pixel owns its spot, even when the background then hides it.
+    std::array<bool,WIDTH> owned{};
+    for(size_t n = 0; n < count; ++n){
+        const uint8_t* sprite = &oam[visible[n]*4];
+        const uint8_t attr = sprite[3];
+        int y = ly+16-sprite[0];
+        if(attr&0x40)
+            y = height-1-y;
+        const uint8_t id = height == 16 ? sprite[2]&0xFE : sprite[2];
+        const auto& tile = tiles.get(vram, id+(y>>3));
+        std::array<uint8_t,8> row;
+        std::copy_n(&tile[(y&7)*8], 8, row.begin());
+        if(attr&0x20)
+            std::reverse(row.begin(), row.end());
+        std::array<uint32_t,8> rgba;
+        kernels->expand(row.data(), get_palette(attr&0x10 ? obp1 : obp0).data(), rgba.data(), 8);
+        for(int i = 0; i < 8; ++i){
+            const int x = sprite[1]-8+i;
+            //  color 0 is transparent, and bg priority hides the sprite behind bg colors 1 to 3.
+            if(x < 0 || x >= (int)WIDTH || !row[i] || owned[x])
+                continue;
+            owned[x] = true;
+            if(!((attr&0x80) && color[x]))
+                line[x] = rgba[i];
+        }
+    }
+}
+
+const sprite_index_t::line_t& ppu_t::select_sprites(){
+    return sprite_index.get(gb->mem.get_oam(), ly);
+}
+
+void ppu_t::on_oam_dma(){
+    sprite_index.rebuild(gb->mem.get_oam(), lcdc&0x04 ? 16 : 8);
+}
+
+void ppu_t::on_oam_write(uint16_t adr, uint8_t val){
+    sync();
+    sprite_index.on_oam_write(gb->mem.get_oam(), adr-0xFE00, val);
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include<ppu/sprite_index.h>
+#include<algorithm>
+
+void sprite_index_t::on_oam_write(const uint8_t* oam, uint8_t offset, uint8_t val){
+    const uint8_t sprite = offset/4;
+    switch(offset%4){
+    case 0:     //  y moves the sprite to other lines.
+        mark(sprite, oam[offset], false);
+        mark(sprite, val, true);
+        break;
+    case 1:     //  x only changes the order within them.
+        mark(sprite, oam[sprite*4], true);
+        break;
+    }
+}
+
+void sprite_index_t::rebuild(const uint8_t* oam, size_t height){
+    this->height = height;
+    masks.fill(0);
+    for(uint8_t sprite = 0; sprite < 40; ++sprite)
+        mark(sprite, oam[sprite*4], true);
+    dirty.fill(true);
+}
+
+void sprite_index_t::mark(uint8_t sprite, uint8_t y, bool set){
+    //  y is the bottom of a 16 line sprite plus one, so it covers y-16 up to y-16+height.
+    for(int line = y-16; line < y-16+(int)height; ++line){
+        if(line < 0 || line >= (int)LINES)
+            continue;
+        if(set)
+            masks[line] |= 1ull<<sprite;
+        else
+            masks[line] &= ~(1ull<<sprite);
+        dirty[line] = true;
+    }
+}
+
+void sprite_index_t::build_line(const uint8_t* oam, size_t ly){
+    auto& line = lines[ly];
+    line.count = 0;
+    //  only the first 10 entries of oam on a line are drawn.
+    for(uint64_t mask = masks[ly]; mask && line.count < PER_LINE; mask &= mask-1)
+        line.sprites[line.count++] = __builtin_ctzll(mask);
+    std::stable_sort(line.sprites.begin(), line.sprites.begin()+line.count, [oam](uint8_t a, uint8_t b){
+        return oam[a*4+1] < oam[b*4+1];
+    });
+    dirty[ly] = false;
+}
\ No newline at end of file
@@ -0,0 +1,8 @@
+#include<ppu/tile_cache.h>
+#include<ppu/pixel_kernels.h>
+
+void tile_cache_t::decode(const uint8_t* vram, size_t tile){
+    static const pixel_kernels_t& kernels = pixel_kernels_t::get();
+    kernels.decode_tile(&vram[tile*16], tiles[tile].data());
+    dirty[tile] = false;
+}
\ No newline at end of file
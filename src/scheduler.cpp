@@ -1,27 +1,56 @@
 #include<scheduler.h>
 #include<stdexcept>
+#include<algorithm>
 
-bool scheduler_t::is_event_pending(){
-    if(events.empty())
+void scheduler_t::process_events(){
+    scheduler_event event;
+    if(!pop_due(event))
+        throw std::runtime_error("sheculder has no due event when trying to process events.");
+    if(handlers[(size_t)event])
+        handlers[(size_t)event]();
+}
+
+bool scheduler_t::pop_due(scheduler_event& event){
+    if(!is_event_pending())
         return false;
-    return cycles >= events.top().first;
+    //  ties go to the lower kind, the order of the enum.
+    const size_t slot = std::min_element(deadlines.begin(), deadlines.end())-deadlines.begin();
+    event = (scheduler_event)slot;
+    deadlines[slot] = NO_EVENT;
+    update_next_stamp();
+    return true;
 }
 
-void scheduler_t::process_events(){
-    if(!events.size())
-        throw std::runtime_error("sheculder event queue is empty when trying to process events.");
-    events.top().second.f();
-    events.pop();
+void scheduler_t::add_event(timestamp_t delay, scheduler_event event){
+    auto& deadline = deadlines[(size_t)event];
+    //  moving the earliest deadline back means some other slot may come first now.
+    const bool was_next = deadline == next_stamp;
+    deadline = cycles+delay;
+    if(was_next)
+        update_next_stamp();
+    else
+        next_stamp = std::min(next_stamp, deadline);
+}
+
+void scheduler_t::cancel(scheduler_event event){
+    auto& deadline = deadlines[(size_t)event];
+    if(deadline == NO_EVENT)
+        return;
+    const bool was_next = deadline == next_stamp;
+    deadline = NO_EVENT;
+    if(was_next)
+        update_next_stamp();
 }
 
-void scheduler_t::add_event(const timestamp_t& stamp, const event_t& event){
-    events.push({stamp+cycles, event});
+size_t scheduler_t::get_pending_count(){
+    return std::count_if(deadlines.begin(), deadlines.end(), [](timestamp_t deadline){ return deadline != NO_EVENT; });
 }
 
-void scheduler_t::tick_system(size_t t_cycles){
-    cycles += t_cycles;
+void scheduler_t::update_next_stamp(){
+    next_stamp = *std::min_element(deadlines.begin(), deadlines.end());
 }
 
-size_t scheduler_t::get_cycles(){
-    return cycles;
+void scheduler_t::fast_forward(size_t max_cycles){
+    if(next_stamp > cycles)
+        cycles = std::min<timestamp_t>(next_stamp, cycles+max_cycles);
 }
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include<timer/timer.h>
+#include<gameboy.h>
+
+uint16_t timer_unit_t::get_counter(){
+    return gb->scheduler.get_cycles()+counter_offset;
+}
+
+void timer_unit_t::sync(){
+    const uint64_t now = gb->scheduler.get_cycles();
+    if(is_enabled()){
+        //  tima counts the times the counter crossed a multiple of the period.
+        uint64_t edges = (now+counter_offset)/get_period()-(tima_stamp+counter_offset)/get_period();
+        while(edges >= (uint64_t)0x100-tima){
+            edges -= 0x100-tima;
+            tima = tma;
+            gb->mem.request_interrupt(interrupt_bit::TIMER);
+        }
+        tima += edges;
+    }
+    tima_stamp = now;
+}
+
+void timer_unit_t::increment(){
+    if(++tima == 0){
+        tima = tma;
+        gb->mem.request_interrupt(interrupt_bit::TIMER);
+    }
+}
+
+void timer_unit_t::schedule(){
+    if(!is_enabled())
+        return gb->scheduler.cancel(scheduler_event::TIMER);
+    const uint64_t counter = gb->scheduler.get_cycles()+counter_offset;
+    const uint64_t period = get_period();
+    //  overflow comes with the (0x100-tima)th falling edge from now.
+    const uint64_t overflow = (counter/period+0x100-tima)*period;
+    gb->scheduler.reschedule(scheduler_event::TIMER, overflow-counter);
+}
+
+void timer_unit_t::update(){
+    sync();
+    schedule();
+}
+
+uint8_t timer_unit_t::read(uint16_t adr){
+    switch(adr){
+    case 0xFF04: return get_counter()>>8;
+    case 0xFF05: sync(); return tima;
+    case 0xFF06: return tma;
+    }
+    return tac|0xF8;
+}
+
+void timer_unit_t::write(uint16_t adr, uint8_t val){
+    sync();
+    switch(adr){
+    case 0xFF04:{
+        //  resetting the counter is a falling edge when the watched bit was set.
+        const bool input = get_input();
+        counter_offset = (uint16_t)(0-gb->scheduler.get_cycles());
+        if(input)
+            increment();
+        break;
+    }
+    case 0xFF05:
+        tima = val;
+        break;
+    case 0xFF06:
+        tma = val;
+        break;
+    case 0xFF07:{
+        //  so is switching the watched bit away while it's set, or disabling the timer.
+        const bool input = get_input();
+        tac = val&0b111;
+        if(input && !get_input())
+            increment();
+        break;
+    }
+    }
+    schedule();
+}
+
+void timer_unit_t::apply_post_boot_state(){
+    counter_offset = (uint16_t)(0xAB00-gb->scheduler.get_cycles());
+    tima = tma = 0;
+    tac = 0;
+    tima_stamp = gb->scheduler.get_cycles();
+    schedule();
+}
\ No newline at end of file
@@ -0,0 +1,289 @@
+#include<test.h>
+#include<functional>
+
+//  every core has to end up where the table interpreter does, the roms halt once they're done.
+static constexpr std::array<cpu_core,3> CORES{cpu_core::BLOCK_CACHE, cpu_core::THREADED, cpu_core::JIT};
+
+static void compare_cores(const char* name, const test::rom_t& rom, const std::function<void(gameboy_t&, cpu_core)>& check){
+    const std::string path = rom.save();
+    auto reference = test::boot(path, cpu_core::INTERPRETER);
+    CHECK(test::run_until_halt(*reference));
+    check(*reference, cpu_core::INTERPRETER);
+    for(cpu_core core: CORES){
+        auto gb = test::boot(path, core);
+        if(!test::run_until_halt(*gb)){
+            std::fprintf(stderr, "%s: core %d never halted\n", name, (int)core);
+            ++test::failures;
+            continue;
+        }
+        check(*gb, core);
+        const size_t failures = test::failures;
+        CHECK_EQ(gb->regs.get<RI::AF>(), reference->regs.get<RI::AF>());
+        CHECK_EQ(gb->regs.get<RI::BC>(), reference->regs.get<RI::BC>());
+        CHECK_EQ(gb->regs.get<RI::DE>(), reference->regs.get<RI::DE>());
+        CHECK_EQ(gb->regs.get<RI::HL>(), reference->regs.get<RI::HL>());
+        CHECK_EQ(gb->regs.get<RI::SP>(), reference->regs.get<RI::SP>());
+        CHECK_EQ(gb->regs.get<RI::PC>(), reference->regs.get<RI::PC>());
+        CHECK_EQ(test::hash_ram(*gb), test::hash_ram(*reference));
+        if(failures != test::failures)
+            std::fprintf(stderr, "%s: core %d differs from the interpreter\n", name, (int)core);
+    }
+}
+
+//  ie cleared, so the halt is never left.
+static constexpr std::initializer_list<uint8_t> STOP{0xAF, 0xE0, 0xFF, 0x76};    //  xor a; ldh (ie),a; halt
+
+//  the usual oam dma routine running from hram, between io writes that must not drop it.
+static void hram_routine(){
+    test::rom_t rom;
+    rom.place(0x0100, {0xC3, 0x50, 0x01});              //  jp 0x0150
+    const uint16_t end = rom.place(0x0150, {
+        0x21, 0x00, 0x02,                               //  ld hl,0x0200
+        0x11, 0x80, 0xFF,                               //  ld de,0xFF80
+        0x0E, 0x0A,                                     //  ld c,10
+        0x2A, 0x12, 0x13, 0x0D, 0x20, 0xFA,             //  ld a,(hl+); ld (de),a; inc de; dec c; jr nz
+        0x06, 0x08,                                     //  ld b,8
+        0xCD, 0x80, 0xFF,                               //  call 0xFF80
+        0x78,                                           //  ld a,b
+        0xE0, 0x05, 0xE0, 0x0F, 0xE0, 0x42, 0xE0, 0x00, //  ldh (tima),a; ldh (if),a; ldh (scy),a; ldh (p1),a
+        0x05, 0x20, 0xF1                                //  dec b; jr nz
+    });
+    rom.place(end, STOP);
+    rom.place(0x0200, {
+        0x3E, 0xC0, 0xE0, 0x46,                         //  ld a,0xC0; ldh (dma),a
+        0x3E, 0x32, 0x3D, 0x20, 0xFD,                   //  ld a,50; dec a; jr nz
+        0xC9                                            //  ret
+    });
+    compare_cores("hram routine", rom, [](gameboy_t& gb, cpu_core core){
+        CHECK_EQ(gb.regs.get<RI::BC>()>>8, 0);
+        CHECK_EQ(gb.mem.debug_read(0xFF80), 0x3E);
+        //  io shares the page with hram, writing it used to throw away every block in ram.
+        if(core == cpu_core::BLOCK_CACHE || core == cpu_core::JIT)
+            CHECK(gb.blocks.find(0xFF80, 0));
+    });
+}
+
+//  code patched in work ram, directly and through its echo, with writes to the rest of its page in between.
+static void self_modifying(){
+    test::rom_t rom;
+    rom.place(0x0100, {0xC3, 0x50, 0x01});              //  jp 0x0150
+    const uint16_t end = rom.place(0x0150, {
+        0x21, 0x00, 0xC0,                               //  ld hl,0xC000
+        0x3E, 0x3E, 0x22, 0x3E, 0x01, 0x22,             //  ld a,0x3E; ld (hl+),a; ld a,1; ld (hl+),a
+        0x3E, 0xC9, 0x22,                               //  ld a,0xC9; ld (hl+),a
+        0xCD, 0x00, 0xC0, 0x47,                         //  call 0xC000; ld b,a
+        0x3E, 0x02, 0xEA, 0x01, 0xE0,                   //  ld a,2; ld (0xE001),a
+        0xCD, 0x00, 0xC0, 0x4F,                         //  call 0xC000; ld c,a
+        0x3E, 0x55, 0xEA, 0x80, 0xC0,                   //  ld a,0x55; ld (0xC080),a
+        0xCD, 0x00, 0xC0, 0x57,                         //  call 0xC000; ld d,a
+        0x3E, 0x03, 0xEA, 0x01, 0xC0,                   //  ld a,3; ld (0xC001),a
+        0xCD, 0x00, 0xC0, 0x5F                          //  call 0xC000; ld e,a
+    });
+    rom.place(end, STOP);
+    compare_cores("self modifying", rom, [](gameboy_t& gb, cpu_core){
+        CHECK_EQ(gb.regs.get<RI::BC>(), 0x0102);
+        CHECK_EQ(gb.regs.get<RI::DE>(), 0x0203);
+    });
+}
+
+//  every alu operation over every pair of operands, their A and F summed into hl.
+static void alu_sweep(){
+    test::rom_t rom;
+    rom.place(0x0100, {0xC3, 0x50, 0x01});              //  jp 0x0150
+    const uint16_t end = rom.place(0x0150, {
+        0x21, 0x00, 0x00,                               //  ld hl,0
+        0x06, 0x00,                                     //  ld b,0
+        0x0E, 0x00,                                     //  ld c,0
+        0x78, 0x81, 0xF5, 0xD1, 0x19,                   //  ld a,b; add a,c; push af; pop de; add hl,de
+        0x78, 0x91, 0xF5, 0xD1, 0x19,                   //  sub c
+        0x78, 0xA1, 0xF5, 0xD1, 0x19,                   //  and c
+        0x78, 0xA9, 0xF5, 0xD1, 0x19,                   //  xor c
+        0x78, 0xB1, 0xF5, 0xD1, 0x19,                   //  or c
+        0x78, 0xB9, 0xF5, 0xD1, 0x19,                   //  cp c
+        0x78, 0xC6, 0x5A, 0xF5, 0xD1, 0x19,             //  add a,0x5A
+        0x78, 0xFE, 0x80, 0xF5, 0xD1, 0x19,             //  cp 0x80
+        0x78, 0xB9, 0x38, 0x01, 0x23,                   //  ld a,b; cp c; jr c,+1; inc hl
+        0x79, 0xC6, 0x07, 0x4F,                         //  ld a,c; add a,7; ld c,a
+        0x20, 0xCB,                                     //  jr nz, back to ld a,b
+        0x05, 0x20, 0xC6                                //  dec b; jr nz, back to ld c,0
+    });
+    rom.place(end, STOP);
+    compare_cores("alu sweep", rom, [](gameboy_t& gb, cpu_core){
+        CHECK_EQ(gb.regs.get<RI::B>(), 0);
+    });
+}
+
+//  loads and stores through mapped pages and through the slow path, often enough to get translated.
+static void loads_and_stores(){
+    test::rom_t rom;
+    rom.place(0x0100, {0xC3, 0x50, 0x01});              //  jp 0x0150
+    const uint16_t end = rom.place(0x0150, {
+        0x21, 0x00, 0x02,                               //  ld hl,0x0200
+        0x11, 0x00, 0xC1,                               //  ld de,0xC100
+        0x0E, 0x10,                                     //  ld c,16
+        0x2A, 0x12, 0x13, 0x0D, 0x20, 0xFA,             //  ld a,(hl+); ld (de),a; inc de; dec c; jr nz
+        0x21, 0x00, 0xC1,                               //  ld hl,0xC100
+        0x46, 0x34, 0x36, 0x99,                         //  ld b,(hl); inc (hl); ld (hl),0x99
+        0xFA, 0x01, 0xC1, 0xEA, 0x80, 0xC1,             //  ld a,(0xC101); ld (0xC180),a
+        0x01, 0x80, 0xFF, 0x02, 0x3C, 0x0A,             //  ld bc,0xFF80; ld (bc),a; inc a; ld a,(bc)
+        0x11, 0x81, 0xE1, 0x12, 0x1A, 0x57,             //  ld de,0xE181; ld (de),a; ld a,(de); ld d,a
+        0x21, 0x00, 0xFE, 0x77, 0x32, 0x5E,             //  ld hl,0xFE00; ld (hl),a; ld (hl-),a; ld e,(hl)
+        0x22, 0x3A, 0x74,                               //  ld (hl+),a; ld a,(hl-); ld (hl),h
+        0xFA, 0x00, 0xC0, 0x3C, 0xEA, 0x00, 0xC0,       //  ld a,(0xC000); inc a; ld (0xC000),a
+        0xFE, 0x20, 0x20, 0xC5                          //  cp 32; jr nz, back to the start
+    });
+    rom.place(end, STOP);
+    rom.place(0x0200, {0x10, 0x21, 0x32, 0x43, 0x54, 0x65, 0x76, 0x87, 0x98, 0xA9, 0xBA, 0xCB, 0xDC, 0xED, 0xFE, 0x0F});
+    compare_cores("loads and stores", rom, [](gameboy_t& gb, cpu_core){
+        CHECK_EQ(gb.mem.debug_read(0xC000), 32);
+        CHECK_EQ(gb.mem.debug_read(0xC10F), 0x0F);
+    });
+}
+
+//  a write to IF raising an interrupt halfway through a fused ld (de),a; inc de.
+static void interrupt_in_fused_pair(){
+    test::rom_t rom;
+    rom.place(0x0050, STOP);                            //  timer vector
+    rom.place(0x0100, {0xC3, 0x50, 0x01});              //  jp 0x0150
+    const uint16_t end = rom.place(0x0150, {
+        0x3E, 0x04, 0xE0, 0xFF,                         //  ld a,4; ldh (ie),a
+        0xFB, 0x00,                                     //  ei; nop
+        0x11, 0x0F, 0xFF,                               //  ld de,0xFF0F
+        0x3E, 0x04,                                     //  ld a,4
+        0x12, 0x13                                      //  ld (de),a; inc de
+    });
+    rom.place(end, STOP);
+    compare_cores("interrupt in fused pair", rom, [end](gameboy_t& gb, cpu_core){
+        CHECK_EQ(gb.regs.get<RI::DE>(), 0xFF0F);
+        CHECK_EQ(gb.regs.get<RI::SP>(), 0xFFFC);
+        CHECK_EQ(gb.mem.debug_read(0xFFFC)|gb.mem.debug_read(0xFFFD)<<8, end-1);
+    });
+}
+
+//  timer interrupts landing in fused runs and idle polling loops. The handler logs TIMA and
+//  the interrupted pc at 0xC800, so any core taking one at another instruction or cycle shows up in ram.
+static void interrupt_timing(){
+    test::rom_t rom;
+    rom.place(0x0050, {0xC3, 0x00, 0x03});              //  timer vector, jp 0x0300
+    rom.place(0x0100, {0xC3, 0x50, 0x01});              //  jp 0x0150
+    const uint16_t end = rom.place(0x0150, {
+        0x3E, 0x05, 0xE0, 0x07,                         //  ld a,5; ldh (tac),a, an overflow every 4096 cycles
+        0xAF, 0xE0, 0x80, 0xEA, 0x00, 0xC0,             //  xor a; ldh (0x80),a; ld (0xC000),a
+        0x3E, 0x04, 0xE0, 0xFF, 0xFB,                   //  ld a,4; ldh (ie),a; ei
+        0x21, 0x00, 0x04, 0x11, 0x00, 0xD0,             //  ld hl,0x0400; ld de,0xD000
+        0x01, 0x00, 0x0C,                               //  ld bc,0x0C00
+        0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1, 0x20, 0xF8, //  ld a,(hl+); ld (de),a; inc de; dec bc; ld a,b; or c; jr nz
+        0xFA, 0x00, 0xC0, 0xFE, 0x30, 0x38, 0xF9,       //  ld a,(0xC000); cp 48; jr c, an idle loop
+        0xF0, 0x44, 0xFE, 0x90, 0x20, 0xFA,             //  ldh a,(ly); cp 0x90; jr nz, another one
+        0xF0, 0x05, 0xEA, 0x01, 0xC0, 0xF3              //  ldh a,(tima); ld (0xC001),a; di
+    });
+    rom.place(end, STOP);
+    rom.place(0x0300, {
+        0xF5, 0xD5, 0xE5,                               //  push af; push de; push hl
+        0xF0, 0x80, 0x5F, 0x16, 0xC8,                   //  ldh a,(0x80); ld e,a; ld d,0xC8
+        0xF0, 0x05, 0x12, 0x1C,                         //  ldh a,(tima); ld (de),a; inc e
+        0xF8, 0x06, 0x2A, 0x12, 0x1C, 0x7E, 0x12, 0x1C, //  ld hl,sp+6; the interrupted pc to (de)
+        0x7B, 0xE0, 0x80,                               //  ld a,e; ldh (0x80),a
+        0x21, 0x00, 0xC0, 0x34,                         //  ld hl,0xC000; inc (hl)
+        0xE1, 0xD1, 0xF1, 0xD9                          //  pop hl; pop de; pop af; reti
+    });
+    for(size_t adr = 0x0400; adr < 0x1000; ++adr)
+        rom.data[adr] = adr*7;
+    compare_cores("interrupt timing", rom, [](gameboy_t& gb, cpu_core){
+        CHECK(gb.mem.debug_read(0xC000) >= 48);
+        CHECK_EQ(gb.mem.debug_read(0xDBFF), (uint8_t)(0x0FFF*7));
+    });
+}
+
+//  a second rom with the same code layout, loaded into the same instance once the first one's blocks are hot.
+static void reload_rom(){
+    std::array<std::string,2> paths;
+    for(size_t i = 0; i < paths.size(); ++i){
+        test::rom_t rom;
+        rom.place(0x0100, {0xC3, 0x50, 0x01});          //  jp 0x0150
+        const uint16_t end = rom.place(0x0150, {
+            0x06, 0x00, 0x0E, 0x40,                     //  ld b,0; ld c,64
+            (uint8_t)(i ? 0x05 : 0x04), 0x0D, 0x20, 0xFC //  inc b or dec b; dec c; jr nz
+        });
+        rom.place(end, STOP);
+        paths[i] = rom.save();
+    }
+    for(cpu_core core: {cpu_core::INTERPRETER, cpu_core::BLOCK_CACHE, cpu_core::THREADED, cpu_core::JIT}){
+        auto gb = test::boot(paths[0], core);
+        CHECK(test::run_until_halt(*gb));
+        CHECK_EQ(gb->regs.get<RI::BC>(), 0x4000);
+        //  the first rom left the cpu halted.
+        gb->halted = false;
+        gb->load_rom(paths[1]);
+        CHECK(test::run_until_halt(*gb));
+        CHECK_EQ(gb->regs.get<RI::BC>(), 0xC000);
+    }
+}
+
+//  oam dma started from a hot rom loop, the cpu reads 0xFF for the rest of it and runs rst 0x38 until the transfer ends.
+static void oam_dma_from_rom(){
+    test::rom_t rom;
+    rom.place(0x0038, {0x08, 0x00, 0xC0});              //  ld (0xC000),sp
+    rom.place(0x003B, STOP);
+    rom.place(0x0100, {0xC3, 0x50, 0x01});              //  jp 0x0150
+    rom.place(0x0150, {
+        0x3E, 0xC0, 0x0E, 0x44, 0x1E, 0x14, 0x06, 0x00, //  ld a,0xC0; ld c,ly; ld e,20; ld b,0
+        0xE2, 0x04, 0x1D, 0x20, 0xFB,                   //  ld (c),a; inc b; dec e; jr nz
+        0x0C, 0x1E, 0x01, 0x18, 0xF6                    //  inc c; ld e,1; jr back, the third time round c is dma
+    });
+    compare_cores("oam dma from rom", rom, [](gameboy_t& gb, cpu_core){
+        CHECK_EQ(gb.regs.get<RI::BC>()>>8, 21);
+        CHECK(gb.regs.get<RI::SP>() < 0xFFFE);
+    });
+}
+
+//  a debugger reset keeps the core and profiling, and with them the fusion setting of the block cache.
+struct resettable_t: gameboy_t{
+    using gameboy_t::dbg_reset;
+    using gameboy_t::dbg_paused;
+    using gameboy_t::core;
+};
+
+static void debugger_reset(){
+    test::rom_t rom;
+    rom.place(0x0100, {0xC3, 0x50, 0x01});              //  jp 0x0150
+    const uint16_t end = rom.place(0x0150, {0x06, 0x64, 0x05, 0x20, 0xFD});  //  ld b,100; dec b; jr nz
+    rom.place(end, STOP);
+    const std::string path = rom.save();
+    const std::array<std::pair<cpu_core,bool>,4> settings{{
+        {cpu_core::JIT, false}, {cpu_core::THREADED, true}, {cpu_core::BLOCK_CACHE, true}, {cpu_core::BLOCK_CACHE, false}
+    }};
+    for(auto [core, profiling]: settings){
+        auto gb = std::make_unique<resettable_t>();
+        gb->set_fast_boot(true);
+        gb->set_cpu_core(core);
+        gb->set_profiling(profiling);
+        gb->load_rom(path);
+        gb->dbg_reset();
+        CHECK_EQ((int)gb->core, (int)core);
+        CHECK_EQ(gb->is_profiling(), profiling);
+        gb->dbg_paused = false;
+        CHECK(test::run_until_halt(*gb));
+        CHECK_EQ(gb->regs.get<RI::BC>()>>8, 0);
+        //  only the block cache without profiling runs dec b; jr nz as one fused entry.
+        if(core != cpu_core::THREADED){
+            const basic_block_t* block = gb->blocks.find(0x0152, 0);
+            CHECK(block);
+            if(block)
+                CHECK_EQ(block->instrs.size(), core == cpu_core::BLOCK_CACHE && !profiling ? 1u : 2u);
+        }
+    }
+}
+
+int main(){
+    hram_routine();
+    self_modifying();
+    alu_sweep();
+    loads_and_stores();
+    interrupt_in_fused_pair();
+    interrupt_timing();
+    reload_rom();
+    oam_dma_from_rom();
+    debugger_reset();
+    return test::report("cores");
+}
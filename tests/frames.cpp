@@ -0,0 +1,49 @@
+#include<test.h>
+
+static constexpr std::array<cpu_core,4> CORES{cpu_core::INTERPRETER, cpu_core::BLOCK_CACHE, cpu_core::THREADED, cpu_core::JIT};
+
+//  a frame ends where the ppu raises vblank, not on multiples of the frame length counted from power on.
+static void stops_at_vblank(){
+    test::rom_t rom;
+    rom.place(0x0100, {0x18, 0xFE});                    //  jr -2
+    const std::string path = rom.save();
+    for(cpu_core core: CORES){
+        auto gb = test::boot(path, core);
+        size_t last = 0;
+        for(size_t i = 0; i < 5; ++i){
+            const size_t frame = gb->ppu.get_frame_count();
+            gb->run_until_vblank();
+            CHECK_EQ(gb->ppu.get_frame_count(), frame+1);
+            CHECK_EQ(gb->mem.debug_read(0xFF44), 144);
+            CHECK(gb->mem.debug_read(0xFF0F)&0x01);
+            //  whatever the step that raised it ran past vblank is made up on the next frame.
+            const size_t now = gb->scheduler.get_cycles();
+            if(i)
+                CHECK(now-last > gameboy_t::CYCLES_PER_FRAME-gameboy_t::THREADED_SLICE && now-last < gameboy_t::CYCLES_PER_FRAME+gameboy_t::THREADED_SLICE);
+            last = now;
+        }
+    }
+}
+
+//  with the lcd off nothing ends the frame, the display still gets one every frame's worth of cycles.
+static void lcd_off(){
+    test::rom_t rom;
+    rom.place(0x0100, {0xAF, 0xE0, 0x40, 0x18, 0xFE}); //  xor a; ldh (lcdc),a; jr -2
+    const std::string path = rom.save();
+    for(cpu_core core: CORES){
+        auto gb = test::boot(path, core);
+        gb->run_until_vblank();
+        for(size_t i = 0; i < 3; ++i){
+            const size_t start = gb->scheduler.get_cycles();
+            gb->run_until_vblank();
+            CHECK_EQ(gb->ppu.get_frame_count(), 0u);
+            CHECK_EQ(gb->scheduler.get_cycles()-start, gameboy_t::CYCLES_PER_FRAME);
+        }
+    }
+}
+
+int main(){
+    stops_at_vblank();
+    lcd_off();
+    return test::report("frames");
+}
@@ -0,0 +1,5 @@
+#include<display/display.h>
+
+//  the tests link every component but the display, whose hooks do nothing here.
+void main_window::bind(gameboy_t& interp){}
+void main_window::on_pause(){}
@@ -0,0 +1,119 @@
+#include<test.h>
+#include<ppu/pixel_kernels.h>
+#include<chrono>
+#include<cstring>
+#include<random>
+#include<vector>
+
+static constexpr std::array<pixel_isa,3> ISAS{pixel_isa::SCALAR, pixel_isa::SSE2, pixel_isa::AVX2};
+
+static bool host_supports(pixel_isa isa){
+#if defined(__x86_64__)
+    switch(isa){
+    case pixel_isa::SCALAR: return true;
+    case pixel_isa::SSE2:   return __builtin_cpu_supports("sse2");
+    case pixel_isa::AVX2:   return __builtin_cpu_supports("avx2");
+    }
+#endif
+    return isa == pixel_isa::SCALAR;
+}
+
+//  every variant the host runs has to agree with the scalar one, the others have to fall back to something that does.
+static void decode_tile(){
+    std::mt19937 rng{42};
+    const auto& scalar = pixel_kernels_t::get(pixel_isa::SCALAR);
+    for(pixel_isa isa: ISAS){
+        const auto& kernels = pixel_kernels_t::get(isa);
+        if(host_supports(isa))
+            CHECK_EQ((int)kernels.isa, (int)isa);
+        for(size_t i = 0; i < 10'000 && !test::failures; ++i){
+            std::array<uint8_t,16> data;
+            for(auto& byte: data)
+                byte = rng();
+            std::array<uint8_t,64> expected, out;
+            scalar.decode_tile(data.data(), expected.data());
+            kernels.decode_tile(data.data(), out.data());
+            CHECK(out == expected);
+        }
+    }
+}
+
+//  odd lengths and offsets cover the scalar tails, the upper index bits have to be ignored.
+static void expand(){
+    std::mt19937 rng{43};
+    const auto& scalar = pixel_kernels_t::get(pixel_isa::SCALAR);
+    for(pixel_isa isa: ISAS){
+        const auto& kernels = pixel_kernels_t::get(isa);
+        for(size_t i = 0; i < 10'000 && !test::failures; ++i){
+            const size_t offset = rng()%8, count = rng()%200;
+            std::vector<uint8_t> indices(offset+count);
+            for(auto& index: indices)
+                index = rng();
+            std::array<uint32_t,4> palette;
+            for(auto& color: palette)
+                color = rng();
+            //  a guard past the end catches stores beyond count.
+            std::vector<uint32_t> expected(offset+count+8, 0xDEADBEEF), out(expected);
+            scalar.expand(&indices[offset], palette.data(), &expected[offset], count);
+            kernels.expand(&indices[offset], palette.data(), &out[offset], count);
+            CHECK(out == expected);
+        }
+    }
+}
+
+static const char* isa_name(pixel_isa isa){
+    switch(isa){
+    case pixel_isa::SCALAR: return "scalar";
+    case pixel_isa::SSE2:   return "sse2";
+    case pixel_isa::AVX2:   return "avx2";
+    }
+    return "?";
+}
+
+//  a frame's worth of work per kernel: every tile of a vram bank decoded, every pixel of the screen expanded.
+static void bench(size_t frames){
+    std::mt19937 rng{44};
+    std::vector<uint8_t> tiles(384*16), decoded(384*64), indices(ppu_t::WIDTH*ppu_t::HEIGHT);
+    std::vector<uint32_t> pixels(indices.size());
+    for(auto& byte: tiles)
+        byte = rng();
+    for(auto& index: indices)
+        index = rng()&0b11;
+    const std::array<uint32_t,4> palette{ppu_t::SHADES[0], ppu_t::SHADES[1], ppu_t::SHADES[2], ppu_t::SHADES[3]};
+    double scalar_decode = 0, scalar_expand = 0;
+    std::printf("%-8s %14s %14s\n", "isa", "decode ns/frame", "expand ns/frame");
+    for(pixel_isa isa: ISAS){
+        if(!host_supports(isa))
+            continue;
+        const auto& kernels = pixel_kernels_t::get(isa);
+        using clock = std::chrono::steady_clock;
+        auto start = clock::now();
+        for(size_t frame = 0; frame < frames; ++frame)
+            for(size_t tile = 0; tile < 384; ++tile)
+                kernels.decode_tile(&tiles[tile*16], &decoded[tile*64]);
+        const double decode = std::chrono::duration<double,std::nano>(clock::now()-start).count()/frames;
+        start = clock::now();
+        for(size_t frame = 0; frame < frames; ++frame)
+            kernels.expand(indices.data(), palette.data(), pixels.data(), pixels.size());
+        const double expand = std::chrono::duration<double,std::nano>(clock::now()-start).count()/frames;
+        if(isa == pixel_isa::SCALAR){
+            scalar_decode = decode;
+            scalar_expand = expand;
+        }
+        std::printf("%-8s %10.0f %5.2fx %10.0f %5.2fx\n", isa_name(isa),
+            decode, scalar_decode/decode, expand, scalar_expand/expand);
+    }
+    //  keeps the results alive.
+    std::printf("checksum %08X\n", decoded[rng()%decoded.size()]^pixels[rng()%pixels.size()]);
+}
+
+int main(int argc, char** argv){
+    //  "bench [frames]" times the variants instead, see make bench.
+    if(argc > 1 && !std::strcmp(argv[1], "bench")){
+        bench(argc > 2 ? std::stoul(argv[2]) : 2000);
+        return 0;
+    }
+    decode_tile();
+    expand();
+    return test::report("pixel kernels");
+}
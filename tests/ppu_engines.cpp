@@ -0,0 +1,76 @@
+#include<test.h>
+
+static constexpr std::array<cpu_core,4> CORES{cpu_core::INTERPRETER, cpu_core::BLOCK_CACHE, cpu_core::THREADED, cpu_core::JIT};
+static constexpr uint32_t WHITE = ppu_t::SHADES[0], BLACK = ppu_t::SHADES[3];
+
+static uint32_t pixel(gameboy_t& gb, size_t x, size_t y){
+    return gb.ppu.get_framebuffer()[y*ppu_t::WIDTH+x];
+}
+
+//  runs the rom up to its halt and the frame to its end.
+static std::unique_ptr<gameboy_t> run_frame(const std::string& path, cpu_core core, ppu_engine engine){
+    auto gb = test::boot(path, core);
+    gb->set_ppu_engine(engine);
+    CHECK(test::run_until_halt(*gb));
+    gb->run_until_vblank();
+    return gb;
+}
+
+//  a tile map entry changed halfway through line 64, the fifo already pushed the pixels of the old tile.
+static void map_write_mid_line(){
+    test::rom_t rom;
+    rom.place(0x0100, {0xC3, 0x50, 0x01});              //  jp 0x0150
+    uint16_t adr = rom.place(0x0150, {
+        0x21, 0x00, 0x88, 0x3E, 0xFF, 0x0E, 0x10,       //  ld hl,0x8800; ld a,0xFF; ld c,16
+        0x22, 0x0D, 0x20, 0xFC,                         //  ld (hl+),a; dec c; jr nz, tile 0x80 all black
+        0x21, 0x00, 0x99, 0x06, 0x80,                   //  ld hl,0x9900; ld b,0x80
+        0xF0, 0x44, 0xFE, 0x40, 0x20, 0xFA              //  ldh a,(ly); cp 0x40; jr nz
+    });
+    //  nops into the middle of mode 3.
+    adr += 25;
+    adr = rom.place(adr, {0x70});                       //  ld (hl),b
+    rom.place(adr, {0xAF, 0xE0, 0xFF, 0x76});           //  xor a; ldh (ie),a; halt
+    const std::string path = rom.save();
+    for(cpu_core core: CORES){
+        auto gb = run_frame(path, core, ppu_engine::FIFO);
+        CHECK_EQ(pixel(*gb, 0, 63), WHITE);
+        CHECK_EQ(pixel(*gb, 0, 64), WHITE);
+        CHECK_EQ(pixel(*gb, 0, 65), BLACK);
+        CHECK_EQ(pixel(*gb, 0, 71), BLACK);
+    }
+}
+
+//  a window with distinct columns against the scrolled background, both engines have to draw the same frame.
+static void window_position(uint8_t wx, uint8_t scx){
+    test::rom_t rom;
+    rom.place(0x0100, {0xC3, 0x50, 0x01});              //  jp 0x0150
+    const uint16_t end = rom.place(0x0150, {
+        0x21, 0x00, 0x88, 0x3E, 0x0F, 0x22, 0x3E, 0x33, 0x22,  //  tile 0x80 rows of 0,0,2,2,1,1,3,3 at 0x8800
+        0x21, 0x00, 0x9C, 0x0E, 0x10,                   //  ld hl,0x9C00; ld c,16
+        0x3E, 0x80, 0x22, 0x3C, 0x22, 0x0D, 0x20, 0xF8, //  ld a,0x80; ld (hl+),a; inc a; ld (hl+),a; dec c; jr nz
+        0x3E, wx, 0xE0, 0x4B, 0xAF, 0xE0, 0x4A,         //  ldh (wx),wx; ldh (wy),0
+        0x3E, scx, 0xE0, 0x43,                          //  ldh (scx),scx
+        0x3E, 0xF1, 0xE0, 0x40                          //  ldh (lcdc),0xF1, window on from the 0x9C00 map
+    });
+    rom.place(end, {0xAF, 0xE0, 0xFF, 0x76});           //  xor a; ldh (ie),a; halt
+    const std::string path = rom.save();
+    auto scanline = run_frame(path, cpu_core::INTERPRETER, ppu_engine::SCANLINE);
+    auto fifo = run_frame(path, cpu_core::INTERPRETER, ppu_engine::FIFO);
+    //  the first frame was half drawn before the registers were set.
+    scanline->run_until_vblank();
+    fifo->run_until_vblank();
+    size_t differing = 0;
+    for(size_t i = 0; i < ppu_t::WIDTH*ppu_t::HEIGHT; ++i)
+        differing += scanline->ppu.get_framebuffer()[i] != fifo->ppu.get_framebuffer()[i];
+    if(differing)
+        std::fprintf(stderr, "window at wx %d, scx %d: %zu pixels differ between the engines\n", wx, scx, differing);
+    CHECK_EQ(differing, 0u);
+}
+
+int main(){
+    map_write_mid_line();
+    for(uint8_t wx: {0, 1, 3, 6, 7, 8, 13, 100, 166})
+        for(uint8_t scx: {0, 3, 7})
+            window_position(wx, scx);
+    return test::report("ppu engines");
+}
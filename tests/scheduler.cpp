@@ -0,0 +1,170 @@
+#include<test.h>
+#include<queue>
+#include<random>
+#include<tuple>
+#include<vector>
+
+//  the slots checked against a plain priority queue, superseded entries are skipped once they reach the top.
+struct reference_t{
+    using entry_t = std::tuple<timestamp_t, size_t, size_t>;   //  deadline, kind, version
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+    std::array<size_t,scheduler_t::EVENT_COUNT> versions{};
+    std::array<bool,scheduler_t::EVENT_COUNT> armed{};
+    timestamp_t cycles{0};
+
+    void add(size_t kind, timestamp_t delay){
+        queue.push({cycles+delay, kind, ++versions[kind]});
+        armed[kind] = true;
+    }
+    void cancel(size_t kind){
+        ++versions[kind];
+        armed[kind] = false;
+    }
+    const entry_t* top(){
+        while(!queue.empty() && std::get<2>(queue.top()) != versions[std::get<1>(queue.top())])
+            queue.pop();
+        return queue.empty() ? nullptr : &queue.top();
+    }
+    timestamp_t next_stamp(){ return top() ? std::get<0>(*top()) : NO_EVENT; }
+    bool pop_due(size_t& kind){
+        if(!top() || std::get<0>(*top()) > cycles)
+            return false;
+        kind = std::get<1>(*top());
+        cancel(kind);
+        return true;
+    }
+};
+
+static void compare_state(scheduler_t& s, reference_t& ref){
+    CHECK_EQ(s.get_cycles(), ref.cycles);
+    CHECK_EQ(s.get_next_stamp(), ref.next_stamp());
+    size_t pending = 0;
+    for(size_t kind = 0; kind < scheduler_t::EVENT_COUNT; ++kind){
+        CHECK_EQ(s.is_scheduled((scheduler_event)kind), ref.armed[kind]);
+        pending += ref.armed[kind];
+    }
+    CHECK_EQ(s.get_pending_count(), pending);
+}
+
+//  random arming, moving, cancelling and ticking, with short delays so deadlines tie often.
+static void random_operations(){
+    std::mt19937 rng{1234};
+    scheduler_t s;
+    reference_t ref;
+    for(size_t i = 0; i < 200'000 && !test::failures; ++i){
+        const size_t kind = rng()%scheduler_t::EVENT_COUNT;
+        const timestamp_t delay = rng()%(rng()%4 ? 16 : 4096);
+        switch(rng()%6){
+        case 0: s.add_event(delay, (scheduler_event)kind);  ref.add(kind, delay); break;
+        case 1: s.reschedule((scheduler_event)kind, delay); ref.add(kind, delay); break;
+        case 2: s.cancel((scheduler_event)kind);            ref.cancel(kind);     break;
+        case 3: s.tick_system(delay);                       ref.cycles += delay;  break;
+        case 4:
+            s.fast_forward(delay);
+            if(ref.next_stamp() > ref.cycles)
+                ref.cycles = std::min<timestamp_t>(ref.next_stamp(), ref.cycles+delay);
+            break;
+        case 5:{
+            //  drains everything due, in deadline order with ties to the lower kind.
+            scheduler_event event;
+            size_t expected;
+            while(ref.pop_due(expected)){
+                CHECK(s.is_event_pending());
+                CHECK(s.pop_due(event));
+                CHECK_EQ((size_t)event, expected);
+            }
+            CHECK(!s.is_event_pending());
+            CHECK(!s.pop_due(event));
+            break;
+        }
+        }
+        compare_state(s, ref);
+    }
+}
+
+//  handlers rearming their own and other slots while events are processed, the way the components do.
+static void rearming_handlers(){
+    std::mt19937 rng{5678};
+    scheduler_t s;
+    reference_t ref;
+    std::vector<size_t> fired;
+    for(size_t kind = 0; kind < scheduler_t::EVENT_COUNT; ++kind){
+        s.set_handler((scheduler_event)kind, [&, kind](){
+            fired.push_back(kind);
+            const size_t other = rng()%scheduler_t::EVENT_COUNT;
+            const timestamp_t delay = rng()%8;
+            if(rng()%2)
+                s.reschedule((scheduler_event)other, delay);
+            else
+                s.cancel((scheduler_event)other);
+            s.add_event(delay+1, (scheduler_event)kind);
+        });
+    }
+    //  the reference replays the same random draws.
+    std::mt19937 ref_rng{5678};
+    for(size_t kind = 0; kind < scheduler_t::EVENT_COUNT; ++kind){
+        s.add_event(kind*3, (scheduler_event)kind);
+        ref.add(kind, kind*3);
+    }
+    for(size_t step = 0; step < 100'000 && !test::failures; ++step){
+        const size_t before = fired.size();
+        while(s.is_event_pending())
+            s.process_events();
+        for(size_t i = before; i < fired.size(); ++i){
+            size_t expected;
+            CHECK(ref.pop_due(expected));
+            CHECK_EQ(fired[i], expected);
+            const size_t other = ref_rng()%scheduler_t::EVENT_COUNT;
+            const timestamp_t delay = ref_rng()%8;
+            if(ref_rng()%2)
+                ref.add(other, delay);
+            else
+                ref.cancel(other);
+            ref.add(expected, delay+1);
+        }
+        size_t expected;
+        CHECK(!ref.pop_due(expected));
+        compare_state(s, ref);
+        s.tick_system(1);
+        ++ref.cycles;
+    }
+    CHECK(fired.size() > 10'000);
+}
+
+//  a rom rewriting tima, tma and tac as fast as it can, toggling the timer on and off, for many frames.
+static void timer_soak(cpu_core core, size_t frames){
+    test::rom_t rom;
+    rom.place(0x0100, {0xC3, 0x50, 0x01});              //  jp 0x0150
+    rom.place(0x0150, {
+        0x06, 0x00,                                     //  ld b,0
+        0x78, 0xE0, 0x06, 0xE0, 0x05, 0xE0, 0x07,       //  ld a,b; ldh (tma),a; ldh (tima),a; ldh (tac),a
+        0x48, 0x0D, 0x20, 0xFD,                         //  ld c,b; dec c; jr nz, a delay growing with b
+        0x04, 0x18, 0xF2                                //  inc b; jr back
+    });
+    auto gb = test::boot(rom.save(), core);
+    size_t fired = 0, stale = 0;
+    gb->scheduler.set_handler(scheduler_event::TIMER, [&](){
+        ++fired;
+        stale += !(gb->mem.debug_read(0xFF07)&0b100);
+        gb->timer.update();
+    });
+    size_t max_pending = 0, armed_while_disabled = 0;
+    const size_t end = gb->scheduler.get_cycles()+frames*gameboy_t::CYCLES_PER_FRAME;
+    while(gb->scheduler.get_cycles() < end){
+        gb->run_for_cycles(gameboy_t::THREADED_SLICE);
+        max_pending = std::max(max_pending, gb->scheduler.get_pending_count());
+        armed_while_disabled += !(gb->mem.debug_read(0xFF07)&0b100) && gb->scheduler.is_scheduled(scheduler_event::TIMER);
+    }
+    CHECK(max_pending <= scheduler_t::EVENT_COUNT);
+    CHECK_EQ(stale, 0u);
+    CHECK_EQ(armed_while_disabled, 0u);
+    CHECK(fired > 0);
+}
+
+int main(){
+    random_operations();
+    rearming_handlers();
+    for(cpu_core core: {cpu_core::INTERPRETER, cpu_core::BLOCK_CACHE, cpu_core::THREADED, cpu_core::JIT})
+        timer_soak(core, 1000);
+    return test::report("scheduler");
+}
@@ -0,0 +1,86 @@
+/*
+    shared helpers of the test programs. Every test is its own executable, returning non zero on a failed check.
+*/
+#pragma once
+#include<gameboy.h>
+#include<array>
+#include<cstdio>
+#include<filesystem>
+#include<fstream>
+#include<initializer_list>
+#include<memory>
+#include<string>
+#include<unistd.h>
+
+namespace test{
+    inline size_t failures = 0;
+
+    inline void check(bool ok, const char* expr, const char* file, int line){
+        if(ok)
+            return;
+        ++failures;
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+    }
+
+    template<typename A, typename B>
+    void check_eq(const A& a, const B& b, const char* expr, const char* file, int line){
+        if(a == b)
+            return;
+        ++failures;
+        std::fprintf(stderr, "%s:%d: %s, 0x%llX != 0x%llX\n", file, line, expr, (unsigned long long)a, (unsigned long long)b);
+    }
+
+    inline int report(const char* name){
+        std::printf("%s: %s\n", name, failures ? "FAILED" : "passed");
+        return failures != 0;
+    }
+
+    //  a 32kb rom without a controller, every byte a nop until placed otherwise.
+    struct rom_t{
+        std::array<uint8_t,0x8000> data{};
+        //  returns the address following the bytes.
+        uint16_t place(uint16_t adr, std::initializer_list<uint8_t> bytes){
+            for(uint8_t byte: bytes)
+                data[adr++] = byte;
+            return adr;
+        }
+        //  images are cached by path, so every save gets a file of its own.
+        std::string save() const{
+            static size_t count = 0;
+            const auto path = std::filesystem::temp_directory_path()/
+                ("gbcpp_test_"+std::to_string(getpid())+"_"+std::to_string(count++)+".gb");
+            std::ofstream{path, std::ios::binary}.write(reinterpret_cast<const char*>(data.data()), data.size());
+            return path.string();
+        }
+    };
+
+    //  fast boot, so the tests don't need the boot rom.
+    inline std::unique_ptr<gameboy_t> boot(const std::string& path, cpu_core core){
+        auto gb = std::make_unique<gameboy_t>();
+        gb->set_fast_boot(true);
+        gb->set_cpu_core(core);
+        gb->load_rom(path);
+        return gb;
+    }
+
+    //  the test roms end with a halt that nothing wakes from.
+    inline bool run_until_halt(gameboy_t& gb, size_t max_cycles = 100'000'000){
+        const size_t deadline = gb.scheduler.get_cycles()+max_cycles;
+        while(!gb.halted && gb.scheduler.get_cycles() < deadline)
+            gb.run_for_cycles(1000);
+        return gb.halted;
+    }
+
+    //  fnv-1a of everything the cpu can address past rom, io aside.
+    inline uint64_t hash_ram(gameboy_t& gb){
+        uint64_t hash = 1469598103934665603ull;
+        for(uint32_t adr = 0x8000; adr < 0x10000; ++adr){
+            if(adr < 0xFF00 || adr >= 0xFF80)
+                hash = (hash^gb.mem.debug_read(adr))*1099511628211ull;
+        }
+        return hash;
+    }
+}
+
+#define CHECK(expr) test::check((expr), #expr, __FILE__, __LINE__)
+#define CHECK_EQ(a, b) test::check_eq((a), (b), #a " == " #b, __FILE__, __LINE__)